@@ -1,24 +1,54 @@
 #include <assert.h>
+#include <stdatomic.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#include "ast.h"
+#include "stb/ds.h"
 
-Node *nodes = NULL;
-size_t node_index = 0;
+#include "ast.h"
+#include "compiler.h"
 
-Node *ast_new(Node_Kind kind, Source_Location location) {
-	if (nodes == NULL || node_index == 1 << 20) {
-		nodes = malloc(sizeof(Node) * 1 << 20);
-		node_index = 0;
+Node_Index ast_new(Node_Kind kind, Source_Location location) {
+	Node_Arena *arena = current_compiler->node_arena;
+	uint32_t index = atomic_fetch_add(&arena->count, 1);
+	if (index == UINT32_MAX) {
+		printf("Too many AST nodes\n");
+		exit(1);
+	}
+	if (index >= atomic_load(&arena->committed)) {
+		node_arena_commit(arena, index);
 	}
 
-	Node *node = &nodes[node_index++];
+	Node *node = &arena->nodes[index];
 	node->kind = kind;
 	node->location = location;
 	node->data_count = 0;
 	node->data = NULL;
-	return node;
+	return index;
+}
+
+Node *node_at(Node_Index index) {
+	assert(index != 0);
+	return &current_compiler->node_arena->nodes[index];
+}
+
+Node_Index node_index(Node *node) {
+	return node - current_compiler->node_arena->nodes;
+}
+
+// Copies a finished child list into an exact-sized stb_ds array, so later arrlen and arrpush keep working
+void *ast_list_new(void *elements, size_t length, size_t element_size) {
+	if (length == 0) return NULL;
+
+	stbds_array_header *header = compiler_ds_realloc(NULL, sizeof(stbds_array_header) + length * element_size);
+	header->length = length;
+	header->capacity = length;
+	header->hash_table = NULL;
+	header->temp = 0;
+
+	memcpy(header + 1, elements, length * element_size);
+	return header + 1;
 }
 
 void set_assign_value(Node *node, Node *assign_value, Assign_Kind assign_kind) {
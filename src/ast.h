@@ -7,10 +7,9 @@
 
 #include "string_view.h"
 
+// Byte offset into the concatenation of every source file, see source_position
 typedef struct {
-	uint16_t path_ref;
-	uint16_t row;
-	uint16_t column;
+	uint32_t offset;
 } Source_Location;
 
 typedef struct Node Node;
@@ -59,6 +58,10 @@ typedef enum {
 	OP_MULTIPLY,
 	OP_DIVIDE,
 	OP_MODULUS,
+	OP_BITWISE_AND,
+	OP_BITWISE_XOR,
+	OP_SHIFT_LEFT,
+	OP_SHIFT_RIGHT,
 	OP_AND,
 	OP_OR
 } Binary_Op_Node_Kind;
@@ -158,6 +161,7 @@ typedef struct {
 	Node *type;
 	bool static_;
 	bool inferred;
+	bool noalias;
 	Node *default_value;
 } Function_Argument;
 
@@ -291,6 +295,7 @@ typedef struct {
 
 typedef struct {
 	Node *value;
+	bool tail;
 } Return_Node;
 
 typedef struct {
@@ -314,6 +319,7 @@ typedef struct {
 typedef struct {
 	Structure_Member *members; // stb_ds
 	bool inherit_function;
+	String_View name;
 } Struct_Type_Node;
 
 typedef struct {
@@ -485,7 +491,13 @@ struct Node {
 	};
 };
 
-Node *ast_new(Node_Kind kind, Source_Location location);
+// Nodes live in one arena shared by every worker and are addressed by 32-bit indices. Index 0 is never handed out
+typedef uint32_t Node_Index;
+
+Node_Index ast_new(Node_Kind kind, Source_Location location);
+Node *node_at(Node_Index index);
+Node_Index node_index(Node *node);
+void *ast_list_new(void *elements, size_t length, size_t element_size);
 
 void set_assign_value(Node *node, Node *assign_value, Assign_Kind assign_kind);
 
@@ -5,18 +5,17 @@
 #include "stb/ds.h"
 
 #include "common.h"
-
-Node_Data *datas = NULL;
-size_t datas_index = 0;
+#include "compiler.h"
 
 Node_Data *data_new() {
-	if (datas == NULL || datas_index == 65536) {
-		datas = malloc(sizeof(Node_Data) * 65536);
-		memset(datas, 0, sizeof(Node_Data) * 65536);
-		datas_index = 0;
+	Compiler *compiler = current_compiler;
+	if (compiler->datas == NULL || compiler->datas_index == 65536) {
+		compiler->datas = compiler_allocate(compiler, sizeof(Node_Data) * 65536);
+		memset(compiler->datas, 0, sizeof(Node_Data) * 65536);
+		compiler->datas_index = 0;
 	}
 
-	Node_Data *data = &datas[datas_index++];
+	Node_Data *data = &compiler->datas[compiler->datas_index++];
 	return data;
 }
 
@@ -27,25 +26,23 @@ Value get_type(Context *context, Node *node) {
 	return data->type;
 }
 
-void *data = NULL;
-size_t data_index = 0;
-
 void *custom_realloc(void *p, size_t old_size, size_t size) {
-	if (data == NULL || data_index + size >= 65536) {
+	Compiler *compiler = current_compiler;
+	if (compiler->data == NULL || compiler->data_index + size >= 65536) {
 		if (size >= 65536) {
-			data = malloc(size);
+			compiler->data = compiler_allocate(compiler, size);
 		} else {
-			data = malloc(65536);
+			compiler->data = compiler_allocate(compiler, 65536);
 		}
-		data_index = 0;
+		compiler->data_index = 0;
 	}
 
-	void *result = data + data_index;
+	void *result = compiler->data + compiler->data_index;
 	if (p != NULL) {
 		memcpy(result, p, old_size);
 	}
 
-	data_index += size;
+	compiler->data_index += size;
 	return result;
 }
 
@@ -162,3 +159,58 @@ Node_Data *data_create(Context *context, Node *node) {
 	set_data(context, node, data);
 	return data;
 }
+
+static Source_File *source_file_of(Data *data, Source_Location location) {
+	size_t low = 0;
+	size_t high = arrlenu(data->source_files);
+	while (high - low > 1) {
+		size_t middle = (low + high) / 2;
+		if (data->source_files[middle].start <= location.offset) {
+			low = middle;
+		} else {
+			high = middle;
+		}
+	}
+
+	return &data->source_files[low];
+}
+
+char *source_path_of(Data *data, Source_Location location) {
+	pthread_mutex_lock(&data->mutex);
+	char *path = source_file_of(data, location)->path;
+	pthread_mutex_unlock(&data->mutex);
+	return path;
+}
+
+Source_Position source_position(Data *data, Source_Location location) {
+	pthread_mutex_lock(&data->mutex);
+	Source_File *file = source_file_of(data, location);
+	if (file->lines == NULL) {
+		arrpush(file->lines, 0);
+		for (uint32_t i = 0; i < file->length; i++) {
+			if (file->source[i] == '\n') {
+				arrpush(file->lines, i + 1);
+			}
+		}
+	}
+
+	uint32_t offset = location.offset - file->start;
+	size_t low = 0;
+	size_t high = arrlenu(file->lines);
+	while (high - low > 1) {
+		size_t middle = (low + high) / 2;
+		if (file->lines[middle] <= offset) {
+			low = middle;
+		} else {
+			high = middle;
+		}
+	}
+
+	Source_Position position = {
+		.path = file->path,
+		.row = low + 1,
+		.column = offset - file->lines[low] + 1
+	};
+	pthread_mutex_unlock(&data->mutex);
+	return position;
+}
@@ -1,6 +1,8 @@
 #ifndef COMMON_H
 #define COMMON_H
 
+#include <pthread.h>
+
 #include "ast.h"
 
 typedef struct Value_Data Value_Data;
@@ -180,6 +182,8 @@ typedef struct {
 	bool compile_only;
 	bool returned;
 	Static_Argument_Variation *function_values;
+	size_t slot_count;
+	bool writes_context;
 } Function_Data;
 
 typedef struct {
@@ -196,6 +200,7 @@ typedef struct {
 	bool want_pointer;
 	bool pointer_access;
 	Value value;
+	size_t index;
 } Structure_Access_Data;
 
 typedef struct {
@@ -339,6 +344,7 @@ struct Node_Data {
 	};
 	Value type;
 	bool processed;
+	size_t slot; // dense index of variables, loops, ifs and catches within their function
 };
 
 Node_Data *data_new();
@@ -349,6 +355,7 @@ typedef struct { Node *key; Node_Data *value; } *Node_Datas;
 
 typedef struct { char *key; Node *value; } *Define_Operators;
 
+typedef struct Compiler Compiler;
 typedef struct Context Context;
 
 typedef enum {
@@ -368,10 +375,20 @@ typedef struct {
 } Codegen;
 
 typedef struct {
-	char *path;
+	char *key;
 	Value value;
 } Cached_File;
 
+typedef struct {
+	Node *node;
+	Scope *scopes; // stb_ds
+} Pending_Function;
+
+typedef struct {
+	Value_Data *type;
+	Value_Data *type_info;
+} Type_Info_Entry;
+
 typedef struct {
 	Node *assign_node;
 	Value wanted_type;
@@ -382,9 +399,49 @@ typedef struct {
 } Temporary_Context;
 
 typedef struct {
-	char **source_files; // stb_ds
+	char *path;
+	char *source;
+	uint32_t start;
+	uint32_t length;
+	uint32_t *lines; // stb_ds
+} Source_File;
+
+typedef struct {
+	char *path;
+	uint32_t row;
+	uint32_t column;
+} Source_Position;
+
+typedef enum {
+	PARSE_JOB_QUEUED,
+	PARSE_JOB_PARSING,
+	PARSE_JOB_DONE,
+	PARSE_JOB_FAILED,
+	PARSE_JOB_CLAIMED
+} Parse_Job_State;
+
+typedef struct {
+	char *path;
+	Node *root;
+	Parse_Job_State state;
+} Parse_Job;
+
+typedef struct {
+	Source_File *source_files; // stb_ds
+	uint32_t source_end;
+	pthread_mutex_t mutex;
+	pthread_cond_t work_available;
+	pthread_cond_t job_finished;
+	char **module_paths; // stb_ds
+	struct { char *key; char *value; } *resolved_modules; // stb_ds
+	Parse_Job *parse_jobs; // stb_ds
+	pthread_t *parse_threads; // stb_ds
+	bool parse_stopping;
 } Data;
 
+char *source_path_of(Data *data, Source_Location location);
+Source_Position source_position(Data *data, Source_Location location);
+
 struct Context {
 	struct { Node *key; Define_Operators *value; } *operators; // stb_ds
 	struct { Node_Data *key; Value value; } *static_variables; // stb_ds
@@ -394,11 +451,17 @@ struct Context {
 	size_t static_id;
 	Temporary_Context temporary_context;
 	Codegen codegen;
-	Cached_File *cached_files; // stb_ds
+	Cached_File *cached_files; // stb_ds, keyed by canonical path
+	struct { size_t key; Type_Info_Entry *value; } *type_infos; // stb_ds, keyed by value_hash
+	Pending_Function *pending_functions; // stb_ds
+	size_t slot_count;
+	bool context_written;
+	Node *tail_return;
 	Node *internal_root;
 	Scope internal_scope;
 	Value context_type;
 	Data *data;
+	Compiler *compiler;
 };
 
 Value get_type(Context *context, Node *node);
@@ -0,0 +1,138 @@
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "stb/ds.h"
+
+#include "compiler.h"
+
+struct Compiler_Block {
+	union {
+		Compiler_Block *next;
+		max_align_t align;
+	};
+};
+
+_Thread_local Compiler *current_compiler = NULL;
+
+#define NODE_ARENA_CHUNK (1 << 16)
+
+static Node_Arena *node_arena_create() {
+	Node_Arena *arena = malloc(sizeof(Node_Arena));
+	arena->nodes = mmap(NULL, (size_t) UINT32_MAX * sizeof(Node), PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (arena->nodes == MAP_FAILED) {
+		printf("Failed to reserve the node arena\n");
+		exit(1);
+	}
+
+	atomic_init(&arena->count, 1);
+	atomic_init(&arena->committed, 0);
+	pthread_mutex_init(&arena->mutex, NULL);
+	return arena;
+}
+
+// Makes the chunk holding index usable, for allocations that ran past what is committed so far
+void node_arena_commit(Node_Arena *arena, uint32_t index) {
+	pthread_mutex_lock(&arena->mutex);
+	uint32_t committed = atomic_load(&arena->committed);
+	if (index >= committed) {
+		uint32_t end = index - index % NODE_ARENA_CHUNK + NODE_ARENA_CHUNK;
+		if (end == 0) end = UINT32_MAX;
+		if (mprotect(arena->nodes + committed, (size_t) (end - committed) * sizeof(Node), PROT_READ | PROT_WRITE) != 0) {
+			printf("Failed to grow the node arena\n");
+			exit(1);
+		}
+		atomic_store(&arena->committed, end);
+	}
+	pthread_mutex_unlock(&arena->mutex);
+}
+
+static void node_arena_destroy(Node_Arena *arena) {
+	munmap(arena->nodes, (size_t) UINT32_MAX * sizeof(Node));
+	pthread_mutex_destroy(&arena->mutex);
+	free(arena);
+}
+
+static Compiler *compiler_new() {
+	Compiler *compiler = malloc(sizeof(Compiler));
+	memset(compiler, 0, sizeof(Compiler));
+	return compiler;
+}
+
+Compiler *compiler_create() {
+	Compiler *compiler = compiler_new();
+	compiler->node_arena = node_arena_create();
+	return compiler;
+}
+
+// Worker instances own the memory of whatever they build, so they live as long as their parent
+Compiler *compiler_create_worker(Compiler *compiler) {
+	Compiler *worker = compiler_new();
+	worker->node_arena = compiler->node_arena;
+	arrpush(compiler->workers, worker);
+	return worker;
+}
+
+void compiler_destroy(Compiler *compiler) {
+	for (long int i = 0; i < arrlen(compiler->workers); i++) {
+		// Workers only borrow the node arena
+		compiler->workers[i]->node_arena = NULL;
+		compiler_destroy(compiler->workers[i]);
+	}
+
+	if (compiler->node_arena != NULL) {
+		node_arena_destroy(compiler->node_arena);
+	}
+
+	for (long int i = 0; i < arrlen(compiler->sources); i++) {
+		Compiler_Source source = compiler->sources[i];
+		if (source.mapped) {
+			munmap(source.contents, source.length);
+		} else {
+			free(source.contents);
+		}
+	}
+
+	Compiler_Block *block = compiler->blocks;
+	while (block != NULL) {
+		Compiler_Block *next = block->next;
+		free(block);
+		block = next;
+	}
+
+	if (current_compiler == compiler) {
+		current_compiler = NULL;
+	}
+
+	free(compiler);
+}
+
+void *compiler_allocate(Compiler *compiler, size_t size) {
+	Compiler_Block *block = malloc(sizeof(Compiler_Block) + size);
+	block->next = compiler->blocks;
+	compiler->blocks = block;
+	return block + 1;
+}
+
+void *compiler_ds_realloc(void *p, size_t s) {
+	Compiler *compiler = current_compiler;
+	if (compiler->ds_data == NULL || compiler->ds_data_index + s >= 65536) {
+		if (s >= 65536) {
+			compiler->ds_data = compiler_allocate(compiler, s);
+		} else {
+			compiler->ds_data = compiler_allocate(compiler, 65536);
+		}
+		compiler->ds_data_index = 0;
+	}
+
+	void *result = compiler->ds_data + compiler->ds_data_index;
+	if (p != NULL) {
+		memcpy(result, p, s);
+	}
+
+	compiler->ds_data_index += s;
+	return result;
+}
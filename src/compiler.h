@@ -0,0 +1,59 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <setjmp.h>
+
+#include "common.h"
+
+typedef struct Compiler_Block Compiler_Block;
+
+// Reserved for the whole index range up front so nodes never move, and committed in chunks as it fills
+typedef struct {
+	Node *nodes;
+	_Atomic uint32_t count;
+	_Atomic uint32_t committed;
+	pthread_mutex_t mutex;
+} Node_Arena;
+
+// A loaded source file, which the AST's string views point into until the instance is destroyed
+typedef struct {
+	char *contents;
+	size_t length;
+	bool mapped;
+} Compiler_Source;
+
+struct Compiler {
+	Compiler_Block *blocks;
+
+	Node_Arena *node_arena; // shared with workers, owned by the instance that isn't one
+	Node_Data *datas;
+	size_t datas_index;
+	Value_Data *values;
+	size_t value_index;
+	char *data;
+	size_t data_index;
+	char *ds_data;
+	size_t ds_data_index;
+
+	jmp_buf jmp;
+	Value jmp_result;
+	Node *function_node;
+	Value *function_arguments;
+
+	Node *sint_node;
+
+	Compiler **workers; // stb_ds
+	Compiler_Source *sources; // stb_ds
+};
+
+// The instance used by the allocators on this thread, which have no Context to reach it through
+extern _Thread_local Compiler *current_compiler;
+
+Compiler *compiler_create();
+Compiler *compiler_create_worker(Compiler *compiler);
+void compiler_destroy(Compiler *compiler);
+void node_arena_commit(Node_Arena *arena, uint32_t index);
+void *compiler_allocate(Compiler *compiler, size_t size);
+void *compiler_ds_realloc(void *p, size_t s);
+
+#endif
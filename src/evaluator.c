@@ -1,5 +1,6 @@
 #include <assert.h>
 #include <linux/limits.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,8 +9,10 @@
 #include "stb/ds.h"
 
 #include "ast.h"
+#include "compiler.h"
 #include "evaluator.h"
 #include "parser.h"
+#include "processor.h"
 #include "util.h"
 #include "value.h"
 
@@ -28,12 +31,6 @@ typedef struct {
 	For_Datas fors; // stb_ds
 } State;
 
-jmp_buf jmp;
-Value jmp_result;
-
-Node *function_node;
-Value *function_arguments;
-
 bool value_equal(Value_Data *value1, Value_Data *value2) {
 	if (value1 == NULL || value2 == NULL) return false;
 	if (value1->tag != value2->tag) return false;
@@ -87,7 +84,8 @@ bool value_equal(Value_Data *value1, Value_Data *value2) {
 			if (arrlen(value1->struct_type.members) != arrlen(value2->struct_type.members)) return false;
 
 			for (long int i = 0; i < arrlen(value1->struct_type.members); i++) {
-				if (!sv_eq(value1->struct_type.node->struct_type.members[i].name, value2->struct_type.node->struct_type.members[i].name)) return false;
+				// Anonymous structs have no node and are compared by their member types alone
+				if (value1->struct_type.node != NULL && !sv_eq(value1->struct_type.node->struct_type.members[i].name, value2->struct_type.node->struct_type.members[i].name)) return false;
 				if (!value_equal(value1->struct_type.members[i].value, value2->struct_type.members[i].value)) return false;
 			}
 
@@ -135,6 +133,7 @@ bool value_equal(Value_Data *value1, Value_Data *value2) {
 			if (arrlen(value1->function_type.arguments) != arrlen(value2->function_type.arguments)) return false;
 			for (long int i = 0; i < arrlen(value1->function_type.arguments); i++) {
 				if (!sv_eq(value1->function_type.arguments[i].identifier, value2->function_type.arguments[i].identifier)) return false;
+				if (value1->function_type.arguments[i].noalias != value2->function_type.arguments[i].noalias) return false;
 				if (!value_equal(value1->function_type.arguments[i].type.value, value2->function_type.arguments[i].type.value)) return false;
 			}
 
@@ -156,9 +155,15 @@ bool value_equal(Value_Data *value1, Value_Data *value2) {
 		case STRING_TYPE_VALUE: {
 			return true;
 		}
+		case FLOAT_TYPE_VALUE: {
+			return value1->float_type.size == value2->float_type.size;
+		}
 		case INTEGER_VALUE: {
 			return value1->integer.value == value2->integer.value;
 		}
+		case FLOAT_VALUE: {
+			return value1->float_.value == value2->float_.value;
+		}
 		case ENUM_VALUE: {
 			return value1->enum_.value == value2->enum_.value;
 		}
@@ -174,12 +179,123 @@ bool value_equal(Value_Data *value1, Value_Data *value2) {
 	}
 }
 
+static size_t hash_combine(size_t hash, size_t value) {
+	return (hash ^ value) * 0x100000001b3;
+}
+
+static size_t hash_value(Value_Data *value, int depth) {
+	if (value == NULL) return 0;
+
+	size_t hash = hash_combine(0xcbf29ce484222325, value->tag);
+	if (depth == 0) return hash;
+	depth--;
+
+	switch (value->tag) {
+		case POINTER_TYPE_VALUE: {
+			return hash_combine(hash, hash_value(value->pointer_type.inner.value, depth));
+		}
+		case ARRAY_TYPE_VALUE: {
+			// Size and sentinel are only compared when the first operand has them, so they can't contribute
+			return hash_combine(hash, hash_value(value->array_type.inner.value, depth));
+		}
+		case ARRAY_VIEW_TYPE_VALUE: {
+			return hash_combine(hash, hash_value(value->array_view_type.inner.value, depth));
+		}
+		case ARRAY_VIEW_VALUE: {
+			hash = hash_combine(hash, value->array_view.length->integer.value);
+			for (long int i = 0; i < value->array_view.length->integer.value; i++) {
+				hash = hash_combine(hash, hash_value(value->array_view.values[i], depth));
+			}
+			return hash;
+		}
+		case OPTIONAL_TYPE_VALUE: {
+			return hash_combine(hash, hash_value(value->optional_type.inner.value, depth));
+		}
+		case RESULT_TYPE_VALUE: {
+			return hash_combine(hash, hash_value(value->result_type.error.value, depth));
+		}
+		case INTEGER_TYPE_VALUE: {
+			return hash_combine(hash_combine(hash, value->integer_type.signed_), value->integer_type.size);
+		}
+		case STRUCT_TYPE_VALUE: {
+			hash = hash_combine(hash, (size_t) value->struct_type.node);
+			for (long int i = 0; i < arrlen(value->struct_type.members); i++) {
+				hash = hash_combine(hash, hash_value(value->struct_type.members[i].value, depth));
+			}
+			return hash;
+		}
+		case TUPLE_TYPE_VALUE: {
+			for (long int i = 0; i < arrlen(value->tuple_type.members); i++) {
+				hash = hash_combine(hash, hash_value(value->tuple_type.members[i].value, depth));
+			}
+			return hash;
+		}
+		case UNION_TYPE_VALUE: {
+			for (long int i = 0; i < arrlen(value->union_type.items); i++) {
+				hash = hash_combine(hash, sv_hash(value->union_type.items[i].identifier));
+				hash = hash_combine(hash, hash_value(value->union_type.items[i].type.value, depth));
+			}
+			return hash;
+		}
+		case TAGGED_UNION_TYPE_VALUE: {
+			for (long int i = 0; i < arrlen(value->tagged_union_type.items); i++) {
+				hash = hash_combine(hash, sv_hash(value->tagged_union_type.items[i].identifier));
+				hash = hash_combine(hash, hash_value(value->tagged_union_type.items[i].type.value, depth));
+			}
+			return hash;
+		}
+		case ENUM_TYPE_VALUE: {
+			for (long int i = 0; i < arrlen(value->enum_type.items); i++) {
+				hash = hash_combine(hash, sv_hash(value->enum_type.items[i]));
+			}
+			return hash;
+		}
+		case FUNCTION_TYPE_VALUE: {
+			for (long int i = 0; i < arrlen(value->function_type.arguments); i++) {
+				hash = hash_combine(hash, sv_hash(value->function_type.arguments[i].identifier));
+				hash = hash_combine(hash, value->function_type.arguments[i].noalias);
+				hash = hash_combine(hash, hash_value(value->function_type.arguments[i].type.value, depth));
+			}
+			hash = hash_combine(hash, hash_value(value->function_type.return_type.value, depth));
+			return hash_combine(hash, value->function_type.variadic);
+		}
+		case FLOAT_TYPE_VALUE: {
+			return hash_combine(hash, value->float_type.size);
+		}
+		case INTEGER_VALUE: {
+			return hash_combine(hash, value->integer.value);
+		}
+		case FLOAT_VALUE: {
+			// Adding zero turns -0.0 into 0.0, since both compare equal and so have to hash alike
+			double float_value = value->float_.value + 0.0;
+			return hash_combine(hash, stbds_hash_bytes(&float_value, sizeof(float_value), 0));
+		}
+		case ENUM_VALUE: {
+			return hash_combine(hash, value->enum_.value);
+		}
+		case BYTE_VALUE: {
+			return hash_combine(hash, value->byte.value);
+		}
+		case STRING_VALUE: {
+			return hash_combine(hash, sv_hash((String_View) { .ptr = value->string.value, .len = value->string.length->integer.value }));
+		}
+		default:
+			return hash;
+	}
+}
+
+// Values that value_equal considers equal hash alike. Nesting below a few levels is left out to keep it cheap
+size_t value_hash(Value_Data *value) {
+	return hash_value(value, 4);
+}
+
 bool type_assignable(Value_Data *type1, Value_Data *type2) {
 	return value_equal(type1, type2);
 }
 
 #define handle_evaluate_error(/* State * */ state, /* Source_Location */ location, /* char * */ fmt, ...) { \
-	printf("%s:%u:%u: " fmt "\n", state->context->data->source_files[location.path_ref], location.row, location.column __VA_OPT__(,) __VA_ARGS__); \
+	Source_Position position = source_position(state->context->data, location); \
+	printf("%s:%u:%u: " fmt "\n", position.path, position.row, position.column __VA_OPT__(,) __VA_ARGS__); \
 	exit(1); \
 }
 
@@ -202,6 +318,10 @@ static Value initialize_value(Value type) {
 			value = create_integer(0);
 			break;
 		}
+		case FLOAT_TYPE_VALUE: {
+			value = create_float(0);
+			break;
+		}
 		case STRUCT_TYPE_VALUE: {
 			value = create_value(STRUCT_VALUE);
 
@@ -253,6 +373,8 @@ static Value clone_value(Value input) {
 		case BOOLEAN_TYPE_VALUE:
 		case INTEGER_VALUE:
 		case INTEGER_TYPE_VALUE:
+		case FLOAT_VALUE:
+		case FLOAT_TYPE_VALUE:
 		case FUNCTION_TYPE_VALUE:
 		case MODULE_VALUE:
 		case STRUCT_TYPE_VALUE:
@@ -267,6 +389,7 @@ static Value clone_value(Value input) {
 }
 
 static Value evaluate_state(State *state, Node *node);
+static Value evaluate_op(State *state, Node *node, Binary_Op_Node_Kind kind, Value_Data *type, Value left_value, Value right_value);
 
 static Value evaluate_function(State *state, Node *node) {
 	Function_Node function = node->function;
@@ -327,8 +450,8 @@ static Value evaluate_struct_type(State *state, Node *node) {
 	}
 
 	if (struct_type.inherit_function) {
-		struct_value_data->struct_type.inherited_node = function_node;
-		struct_value_data->struct_type.inherited_arguments = function_arguments;
+		struct_value_data->struct_type.inherited_node = state->context->compiler->function_node;
+		struct_value_data->struct_type.inherited_arguments = state->context->compiler->function_arguments;
 	}
 
 	Scope *scopes = NULL;
@@ -478,13 +601,36 @@ static Value evaluate_identifier(State *state, Node *node) {
 		case IDENTIFIER_STATIC_VARIABLE:
 			return hmget(state->context->static_variables, identifier_data.static_variable.node_data);
 		case IDENTIFIER_ARGUMENT:
-			return function_arguments[identifier_data.argument_index];
+			return state->context->compiler->function_arguments[identifier_data.argument_index];
 		case IDENTIFIER_UNDERSCORE:
 			return (Value) {};
 		case IDENTIFIER_VARIABLE: {
 			Node_Data *variable_data = get_data(state->context, identifier_data.variable);
 			if (identifier.assign_value != NULL) {
-				hmput(state->variables, variable_data, evaluate_state(state, identifier.assign_value));
+				Value value = evaluate_state(state, identifier.assign_value);
+				if (identifier.assign_kind != ASSIGN_STANDARD) {
+					Binary_Op_Node_Kind kind;
+					switch (identifier.assign_kind) {
+						case ASSIGN_COMPOUND_ADD:
+							kind = OP_ADD;
+							break;
+						case ASSIGN_COMPOUND_SUBTRACT:
+							kind = OP_SUBTRACT;
+							break;
+						case ASSIGN_COMPOUND_MULTIPLY:
+							kind = OP_MULTIPLY;
+							break;
+						case ASSIGN_COMPOUND_DIVIDE:
+							kind = OP_DIVIDE;
+							break;
+						default:
+							assert(false);
+					}
+
+					value = evaluate_op(state, node, kind, identifier_data.type.value, hmget(state->variables, variable_data), value);
+				}
+
+				hmput(state->variables, variable_data, value);
 				return (Value) {};
 			} else {
 				Value value = hmget(state->variables, variable_data);
@@ -537,14 +683,21 @@ static Value evaluate_string(State *state, Node *node) {
 }
 
 static Value evaluate_number(State *state, Node *node) {
-	(void) state;
 	Number_Node number = node->number;
+	Value_Data *type = get_data(state->context, node)->number.type.value;
 	switch (number.tag) {
 		case INTEGER_NUMBER: {
+			if (type != NULL && type->tag == FLOAT_TYPE_VALUE) {
+				return create_value_data(create_float(number.integer).value, node);
+			}
+
 			Value_Data *value = value_new(INTEGER_VALUE);
 			value->integer.value = number.integer;
 			return create_value_data(value, node);
 		}
+		case DECIMAL_NUMBER: {
+			return create_value_data(create_float(number.decimal).value, node);
+		}
 		default:
 			assert(false);
 			return (Value) {};
@@ -582,15 +735,19 @@ static Value evaluate_call(State *state, Node *node) {
 		arrpush(arguments, clone_value(evaluate_state(state, call.arguments[i].node)));
 	}
 
+	// Function bodies are processed after their signatures, so finish them before running any
+	process_pending_functions(state->context);
+
 	Value_Data *result = NULL;
 
 	size_t saved_static_id = state->context->static_id;
 	state->context->static_id = function.value->function.static_id;
 
-	Value *saved_function_arguments = function_arguments;
-	Node *saved_function_node = function_node;
-	function_arguments = arguments;
-	function_node = function.value->function.node;
+	Compiler *compiler = state->context->compiler;
+	Value *saved_function_arguments = compiler->function_arguments;
+	Node *saved_function_node = compiler->function_node;
+	compiler->function_arguments = arguments;
+	compiler->function_node = function.value->function.node;
 
 	assert(function.value->tag == FUNCTION_VALUE);
 
@@ -604,98 +761,176 @@ static Value evaluate_call(State *state, Node *node) {
 	state->switchs = NULL;
 	state->fors = NULL;
 
+	long int saved_scopes_length = arrlen(state->context->scopes);
+
 	jmp_buf prev_jmp;
-	memcpy(&prev_jmp, &jmp, sizeof(jmp_buf));
-	if (!setjmp(jmp)) {
+	memcpy(&prev_jmp, &compiler->jmp, sizeof(jmp_buf));
+	if (!setjmp(compiler->jmp)) {
 		arrpush(state->context->scopes, ((Scope) { .node = node, .has_static_id = true, .static_id = function_value.static_id }));
 		result = evaluate_state(state, function_value.body).value;
-		(void) arrpop(state->context->scopes);
 	} else {
-		result = jmp_result.value;
+		result = compiler->jmp_result.value;
 	}
-	memcpy(&jmp, &prev_jmp, sizeof(jmp_buf));
+	memcpy(&compiler->jmp, &prev_jmp, sizeof(jmp_buf));
+
+	arrsetlen(state->context->scopes, saved_scopes_length);
 
 	state->variables = saved_variables;
 	state->switchs = saved_switchs;
 	state->fors = saved_fors;
 
-	function_arguments = saved_function_arguments;
-	function_node = saved_function_node;
+	compiler->function_arguments = saved_function_arguments;
+	compiler->function_node = saved_function_node;
 	state->context->static_id = saved_static_id;
 
 	return clone_value(create_value_data(result, node));
 }
 
-static Value evaluate_binary_op(State *state, Node *node) {
-	Binary_Op_Node binary_operator = node->binary_op;
+static Value wrap_integer(Value_Data *type, unsigned long value) {
+	if (type->tag != INTEGER_TYPE_VALUE || type->integer_type.size >= 64) {
+		return create_integer(value);
+	}
 
-	Value left_value = evaluate_state(state, binary_operator.left);
-	Value right_value = evaluate_state(state, binary_operator.right);
+	size_t size = type->integer_type.size;
+	unsigned long mask = (1UL << size) - 1;
+	value &= mask;
+	if (type->integer_type.signed_ && (value & (1UL << (size - 1)))) {
+		value |= ~mask;
+	}
+
+	return create_integer(value);
+}
 
-	Value true_value = create_value(BOOLEAN_VALUE);
-	true_value.value->boolean.value = true;
+static Value wrap_float(Value_Data *type, double value) {
+	if (type->float_type.size == 32) {
+		return create_float((float) value);
+	}
 
-	Value false_value = create_value(BOOLEAN_VALUE);
-	false_value.value->boolean.value = false;
+	return create_float(value);
+}
 
-	switch (binary_operator.operator) {
-		case OP_EQUALS: {
-			if (value_equal(left_value.value, right_value.value)) {
-				return true_value;
-			} else {
-				return false_value;
-			}
-		}
-		case OP_NOT_EQUALS: {
-			if (value_equal(left_value.value, right_value.value)) {
-				return false_value;
-			} else {
-				return true_value;
-			}
-		}
-		case OP_LESS: {
-			if (left_value.value->integer.value < right_value.value->integer.value) {
-				return true_value;
-			} else {
-				return false_value;
+static Value evaluate_float_op(State *state, Node *node, Binary_Op_Node_Kind kind, Value_Data *type, double left, double right) {
+	switch (kind) {
+		case OP_LESS:
+			return create_boolean(left < right);
+		case OP_LESS_EQUALS:
+			return create_boolean(left <= right);
+		case OP_GREATER:
+			return create_boolean(left > right);
+		case OP_GREATER_EQUALS:
+			return create_boolean(left >= right);
+		case OP_ADD:
+			return wrap_float(type, left + right);
+		case OP_SUBTRACT:
+			return wrap_float(type, left - right);
+		case OP_MULTIPLY:
+			return wrap_float(type, left * right);
+		case OP_DIVIDE:
+			return wrap_float(type, left / right);
+		case OP_MODULUS:
+			return wrap_float(type, fmod(left, right));
+		default:
+			handle_evaluate_error(state, node->location, "Cannot evaluate operator on floats at compile time");
+			return (Value) {};
+	}
+}
+
+static Value evaluate_integer_op(State *state, Node *node, Binary_Op_Node_Kind kind, Value_Data *type, unsigned long left, unsigned long right) {
+	bool signed_ = type->tag == INTEGER_TYPE_VALUE && type->integer_type.signed_;
+	size_t size = type->tag == INTEGER_TYPE_VALUE ? type->integer_type.size : 64;
+
+	switch (kind) {
+		case OP_LESS:
+			return create_boolean(signed_ ? (long) left < (long) right : left < right);
+		case OP_LESS_EQUALS:
+			return create_boolean(signed_ ? (long) left <= (long) right : left <= right);
+		case OP_GREATER:
+			return create_boolean(signed_ ? (long) left > (long) right : left > right);
+		case OP_GREATER_EQUALS:
+			return create_boolean(signed_ ? (long) left >= (long) right : left >= right);
+		case OP_ADD:
+			return wrap_integer(type, left + right);
+		case OP_SUBTRACT:
+			return wrap_integer(type, left - right);
+		case OP_MULTIPLY:
+			return wrap_integer(type, left * right);
+		case OP_DIVIDE:
+		case OP_MODULUS: {
+			if (right == 0) {
+				handle_evaluate_error(state, node->location, "Division by zero");
 			}
-		}
-		case OP_LESS_EQUALS: {
-			if (left_value.value->integer.value <= right_value.value->integer.value) {
-				return true_value;
+
+			if (signed_) {
+				// Avoid the overflow of the minimum value divided by -1
+				if ((long) right == -1) {
+					return wrap_integer(type, kind == OP_DIVIDE ? -left : 0);
+				}
+
+				long result = kind == OP_DIVIDE ? (long) left / (long) right : (long) left % (long) right;
+				return wrap_integer(type, result);
 			} else {
-				return false_value;
+				return wrap_integer(type, kind == OP_DIVIDE ? left / right : left % right);
 			}
 		}
-		case OP_GREATER: {
-			if (left_value.value->integer.value > right_value.value->integer.value) {
-				return true_value;
-			} else {
-				return false_value;
+		case OP_BITWISE_AND:
+			return wrap_integer(type, left & right);
+		case OP_BITWISE_XOR:
+			return wrap_integer(type, left ^ right);
+		case OP_SHIFT_LEFT:
+		case OP_SHIFT_RIGHT: {
+			if (right >= size) {
+				handle_evaluate_error(state, node->location, "Shift amount %lu exceeds width of %zu bits", right, size);
 			}
-		}
-		case OP_GREATER_EQUALS: {
-			if (left_value.value->integer.value >= right_value.value->integer.value) {
-				return true_value;
+
+			if (kind == OP_SHIFT_LEFT) {
+				return wrap_integer(type, left << right);
+			} else if (signed_) {
+				return wrap_integer(type, (long) left >> right);
 			} else {
-				return false_value;
+				return wrap_integer(type, left >> right);
 			}
 		}
-		case OP_ADD: {
-			return create_integer(left_value.value->integer.value + right_value.value->integer.value);
-		}
-		case OP_SUBTRACT: {
-			return create_integer(left_value.value->integer.value - right_value.value->integer.value);
-		}
-		case OP_AND: {
-			return create_boolean(left_value.value->boolean.value && right_value.value->boolean.value);
-		}
 		default:
 			assert(false);
 			return (Value) {};
 	}
 }
 
+static Value evaluate_op(State *state, Node *node, Binary_Op_Node_Kind kind, Value_Data *type, Value left_value, Value right_value) {
+	switch (kind) {
+		case OP_EQUALS:
+			return create_boolean(value_equal(left_value.value, right_value.value));
+		case OP_NOT_EQUALS:
+			return create_boolean(!value_equal(left_value.value, right_value.value));
+		case OP_AND:
+			return create_boolean(left_value.value->boolean.value && right_value.value->boolean.value);
+		case OP_OR:
+			return create_boolean(left_value.value->boolean.value || right_value.value->boolean.value);
+		default:
+			break;
+	}
+
+	if (type->tag == FLOAT_TYPE_VALUE) {
+		return evaluate_float_op(state, node, kind, type, left_value.value->float_.value, right_value.value->float_.value);
+	} else {
+		return evaluate_integer_op(state, node, kind, type, left_value.value->integer.value, right_value.value->integer.value);
+	}
+}
+
+static Value evaluate_binary_op(State *state, Node *node) {
+	Binary_Op_Node binary_operator = node->binary_op;
+	Binary_Operator_Data binary_operator_data = get_data(state->context, node)->binary_operator;
+
+	if (binary_operator_data.function.value.value != NULL) {
+		handle_evaluate_error(state, node->location, "Cannot evaluate overloaded operator at compile time");
+	}
+
+	Value left_value = evaluate_state(state, binary_operator.left);
+	Value right_value = evaluate_state(state, binary_operator.right);
+
+	return evaluate_op(state, node, binary_operator.operator, binary_operator_data.type.value, left_value, right_value);
+}
+
 static Value evaluate_block(State *state, Node *node) {
 	Block_Node block = node->block;
 
@@ -720,8 +955,8 @@ static Value evaluate_return(State *state, Node *node) {
 		result = create_value_data(value_new(NONE_VALUE), node);
 	}
 
-	jmp_result = result;
-	longjmp(jmp, 1);
+	state->context->compiler->jmp_result = result;
+	longjmp(state->context->compiler->jmp, 1);
 }
 
 static Value evaluate_structure(State *state, Node *node) {
@@ -756,6 +991,10 @@ static void print_value(Value_Data *value) {
 			printf("%li", value->integer.value);
 			break;
 		}
+		case FLOAT_VALUE: {
+			printf("%g", value->float_.value);
+			break;
+		}
 		case BOOLEAN_VALUE: {
 			printf("%s", value->boolean.value ? "true" : "false");
 			break;
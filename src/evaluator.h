@@ -4,4 +4,5 @@
 
 bool type_assignable(Value_Data *type1, Value_Data *type2);
 bool value_equal(Value_Data *value1, Value_Data *value2);
+size_t value_hash(Value_Data *value);
 Value evaluate(Context *context, Node *node);
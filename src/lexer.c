@@ -3,17 +3,20 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "stb/ds.h"
+
 #include "lexer.h"
 
-Lexer lexer_create(char *source, size_t source_length, uint32_t path_ref) {
+Lexer lexer_create(char *source, size_t source_length, uint32_t source_start) {
 	return (Lexer) {
 		.source = source,
 		.source_length = source_length,
 		.position = 0,
-		.row = 1,
-		.column = 1,
-		.has_cached = false,
-		.path_ref = path_ref
+		.source_start = source_start
 	};
 }
 
@@ -33,10 +36,18 @@ static bool is_whitespace(char character) {
 	return character == ' ' || character == '\n' || character == '\t';
 }
 
+static Source_Location location_at(Lexer *lexer, size_t position) {
+	if (lexer->constant_location) {
+		return lexer->location;
+	}
+
+	return (Source_Location) { .offset = lexer->source_start + position };
+}
+
 static Token_Data create_token(Token_Kind kind, Lexer *lexer) {
 	return (Token_Data) {
 		.kind = kind,
-		.location = { .path_ref = lexer->path_ref, .row = lexer->row, .column = lexer->column - 1 }
+		.location = location_at(lexer, lexer->token_start)
 	};
 }
 
@@ -68,9 +79,92 @@ static double extract_decimal(char *source, size_t start, size_t end) {
 
 static void increment_position(Lexer *lexer) {
 	lexer->position++;
-	if (!lexer->constant_row_column) {
-		lexer->column++;
+}
+
+static void advance_position(Lexer *lexer, size_t position) {
+	lexer->position = position;
+}
+
+static void skip_whitespace(Lexer *lexer) {
+	char *source = lexer->source;
+	size_t position = lexer->position;
+
+#if defined(__SSE2__)
+	__m128i space = _mm_set1_epi8(' ');
+	__m128i tab = _mm_set1_epi8('\t');
+	__m128i newline = _mm_set1_epi8('\n');
+	while (position + 16 <= lexer->source_length) {
+		__m128i chunk = _mm_loadu_si128((__m128i *) (source + position));
+		__m128i whitespace_bytes = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)), _mm_cmpeq_epi8(chunk, newline));
+
+		unsigned int other_mask = ~_mm_movemask_epi8(whitespace_bytes) & 0xFFFF;
+		if (other_mask != 0) {
+			position += __builtin_ctz(other_mask);
+			break;
+		}
+		position += 16;
+	}
+#endif
+
+	while (position < lexer->source_length && is_whitespace(source[position])) {
+		position++;
 	}
+
+	advance_position(lexer, position);
+}
+
+static size_t scan_alphanumeric_plus(char *source, size_t position, size_t length) {
+#if defined(__SSE2__)
+	__m128i lower_start = _mm_set1_epi8('a' - 1);
+	__m128i lower_end = _mm_set1_epi8('z' + 1);
+	__m128i upper_start = _mm_set1_epi8('A' - 1);
+	__m128i upper_end = _mm_set1_epi8('Z' + 1);
+	__m128i digit_start = _mm_set1_epi8('0' - 1);
+	__m128i digit_end = _mm_set1_epi8('9' + 1);
+	__m128i underscore = _mm_set1_epi8('_');
+	__m128i hash = _mm_set1_epi8('#');
+	while (position + 16 <= length) {
+		__m128i chunk = _mm_loadu_si128((__m128i *) (source + position));
+		__m128i lower = _mm_and_si128(_mm_cmpgt_epi8(chunk, lower_start), _mm_cmplt_epi8(chunk, lower_end));
+		__m128i upper = _mm_and_si128(_mm_cmpgt_epi8(chunk, upper_start), _mm_cmplt_epi8(chunk, upper_end));
+		__m128i digit = _mm_and_si128(_mm_cmpgt_epi8(chunk, digit_start), _mm_cmplt_epi8(chunk, digit_end));
+		__m128i other = _mm_or_si128(_mm_cmpeq_epi8(chunk, underscore), _mm_cmpeq_epi8(chunk, hash));
+		__m128i matches = _mm_or_si128(_mm_or_si128(lower, upper), _mm_or_si128(digit, other));
+
+		unsigned int other_mask = ~_mm_movemask_epi8(matches) & 0xFFFF;
+		if (other_mask != 0) {
+			return position + __builtin_ctz(other_mask);
+		}
+		position += 16;
+	}
+#endif
+
+	while (position < length && is_alphanumeric_plus(source[position])) {
+		position++;
+	}
+	return position;
+}
+
+static size_t scan_numeric(char *source, size_t position, size_t length) {
+#if defined(__SSE2__)
+	__m128i digit_start = _mm_set1_epi8('0' - 1);
+	__m128i digit_end = _mm_set1_epi8('9' + 1);
+	while (position + 16 <= length) {
+		__m128i chunk = _mm_loadu_si128((__m128i *) (source + position));
+		__m128i digit = _mm_and_si128(_mm_cmpgt_epi8(chunk, digit_start), _mm_cmplt_epi8(chunk, digit_end));
+
+		unsigned int other_mask = ~_mm_movemask_epi8(digit) & 0xFFFF;
+		if (other_mask != 0) {
+			return position + __builtin_ctz(other_mask);
+		}
+		position += 16;
+	}
+#endif
+
+	while (position < length && is_numeric(source[position])) {
+		position++;
+	}
+	return position;
 }
 
 bool streq_len(char *s1, size_t l1, char *s2, size_t l2) {
@@ -124,6 +218,7 @@ static Token_Kind get_range_token_kind(char *source, size_t start, size_t end) {
 			break;
 		case 'n':
 			if (streq_len(identifier, len, "not", 3)) result = KEYWORD_NOT;
+			else if (streq_len(identifier, len, "noalias", 7)) result = KEYWORD_NOALIAS;
 			break;
 		case 'o':
 			if (streq_len(identifier, len, "op", 2)) result = KEYWORD_OP;
@@ -139,6 +234,7 @@ static Token_Kind get_range_token_kind(char *source, size_t start, size_t end) {
 			break;
 		case 't':
 			if (streq_len(identifier, len, "tagged_union", 12)) result = KEYWORD_TAGGED_UNION;
+			else if (streq_len(identifier, len, "tail", 4)) result = KEYWORD_TAIL;
 			break;
 		case 'u':
 			if (streq_len(identifier, len, "union", 5)) result = KEYWORD_UNION;
@@ -154,35 +250,23 @@ static bool is_comment(Lexer *lexer) {
 	return lexer->position < lexer->source_length - 1 && lexer->source[lexer->position] == '/' && lexer->source[lexer->position + 1] == '/';
 }
 
-Token_Data lexer_next(Lexer *lexer, bool advance) {
-	if (lexer->has_cached) {
-		lexer->has_cached = !advance;
-		return lexer->cached_token;
-	}
-	
+Token_Data lexer_next(Lexer *lexer) {
+	lexer->token_start = lexer->position;
 	if (lexer->position == lexer->source_length) {
 		return create_token(END_OF_FILE, lexer);
 	}
 
-	bool is_current_comment = false;
-	while (is_whitespace(lexer->source[lexer->position]) || is_comment(lexer) || is_current_comment) {
-		if (lexer->source[lexer->position] == '\n') {
-			if (!lexer->constant_row_column) {
-				lexer->row++;
-				lexer->column = 0;
-			}
-			is_current_comment = false;
-		}
-
-		if (is_comment(lexer)) {
-			is_current_comment = true;
-		}
+	while (true) {
+		skip_whitespace(lexer);
+		if (!is_comment(lexer)) break;
 
-		increment_position(lexer);
+		char *newline = memchr(lexer->source + lexer->position, '\n', lexer->source_length - lexer->position);
+		advance_position(lexer, newline != NULL ? (size_t) (newline - lexer->source) : lexer->source_length);
+	}
 
-		if (lexer->position == lexer->source_length) {
-			return create_token(END_OF_FILE, lexer);
-		}
+	lexer->token_start = lexer->position;
+	if (lexer->position == lexer->source_length) {
+		return create_token(END_OF_FILE, lexer);
 	}
 
 	Token_Data result = {};
@@ -286,6 +370,15 @@ Token_Data lexer_next(Lexer *lexer, bool advance) {
 			result = create_token(BRACE_CLOSED, lexer);
 			break;
 		case '<':
+			if (lexer->source[lexer->position] == '=') {
+				increment_position(lexer);
+				result = create_token(LESS_EQUALS, lexer);
+				break;
+			} else if (lexer->source[lexer->position] == '<') {
+				increment_position(lexer);
+				result = create_token(LESS_LESS, lexer);
+				break;
+			}
 			result = create_token(LESS, lexer);
 			break;
 		case '>':
@@ -293,6 +386,10 @@ Token_Data lexer_next(Lexer *lexer, bool advance) {
 				increment_position(lexer);
 				result = create_token(GREATER_EQUALS, lexer);
 				break;
+			} else if (lexer->source[lexer->position] == '>') {
+				increment_position(lexer);
+				result = create_token(GREATER_GREATER, lexer);
+				break;
 			}
 			result = create_token(GREATER, lexer);
 			break;
@@ -317,51 +414,51 @@ Token_Data lexer_next(Lexer *lexer, bool advance) {
 		}
 		case '"': {
 			size_t string_start = lexer->position;
-			size_t string_start_row = lexer->row;
-			size_t string_start_column = lexer->column - 1;
 
-			while (lexer->source[lexer->position] != '"' || lexer->source[lexer->position - 1] == '\\') {
+			size_t string_position = lexer->position;
+			while (true) {
+				char *quote = memchr(lexer->source + string_position, '"', lexer->source_length - string_position);
+				string_position = quote != NULL ? (size_t) (quote - lexer->source) : lexer->source_length;
+				if (quote == NULL || lexer->source[string_position - 1] != '\\') break;
+				string_position++;
+			}
+			size_t string_end = string_position;
+			advance_position(lexer, string_position);
+			if (lexer->position < lexer->source_length) {
 				increment_position(lexer);
 			}
-			increment_position(lexer);
-
-			size_t string_end = lexer->position - 1;
 
 			result = (Token_Data) {
 				.kind = STRING,
 				.string = extract_string(lexer->source, string_start, string_end),
-				.location = { .path_ref = lexer->path_ref, .row = string_start_row, .column = string_start_column }
+				.location = location_at(lexer, lexer->token_start)
 			};
 			break;
 		}
 		case '\'': {
 			size_t string_start = lexer->position;
-			size_t string_start_row = lexer->row;
-			size_t string_start_column = lexer->column - 1;
 
-			while (lexer->source[lexer->position] != '\'') {
+			while (lexer->position < lexer->source_length && lexer->source[lexer->position] != '\'') {
 				increment_position(lexer);
 			}
-			increment_position(lexer);
 
-			size_t string_end = lexer->position - 1;
+			size_t string_end = lexer->position;
+			if (lexer->position < lexer->source_length) {
+				increment_position(lexer);
+			}
 
 			result = (Token_Data) {
 				.kind = CHARACTER,
 				.string = extract_string(lexer->source, string_start, string_end),
-				.location = { .path_ref = lexer->path_ref, .row = string_start_row, .column = string_start_column }
+				.location = location_at(lexer, lexer->token_start)
 			};
 			break;
 		}
 		default: {
 			if (is_alphabetical_plus(character)) {
 				size_t string_start = lexer->position - 1;
-				size_t string_start_row = lexer->row;
-				size_t string_start_column = lexer->column - 1;
 
-				while (is_alphanumeric_plus(lexer->source[lexer->position]) && lexer->position < lexer->source_length) {
-					increment_position(lexer);
-				}
+				advance_position(lexer, scan_alphanumeric_plus(lexer->source, lexer->position, lexer->source_length));
 
 				size_t string_end = lexer->position;
 
@@ -372,30 +469,24 @@ Token_Data lexer_next(Lexer *lexer, bool advance) {
 					result = (Token_Data) {
 						.kind = IDENTIFIER,
 						.string = extracted_string,
-						.location = { .path_ref = lexer->path_ref, .row = string_start_row, .column = string_start_column }
+						.location = location_at(lexer, lexer->token_start)
 					};
 				} else {
 					result = (Token_Data) {
 						.kind = kind,
-						.location = { .path_ref = lexer->path_ref, .row = string_start_row, .column = string_start_column }
+						.location = location_at(lexer, lexer->token_start)
 					};
 				}
 				break;
 			} else if (is_numeric(character) || character == '-') {
 				if (is_numeric(character) || is_numeric(lexer->source[lexer->position])) {
 					size_t number_start = lexer->position - 1;
-					size_t number_start_row = lexer->row;
-					size_t number_start_column = lexer->column - 1;
 
-					while (is_numeric(lexer->source[lexer->position])) {
-						increment_position(lexer);
-					}
+					advance_position(lexer, scan_numeric(lexer->source, lexer->position, lexer->source_length));
 
 					if (lexer->source[lexer->position] == '.' && lexer->source[lexer->position + 1] != '.') {
 						increment_position(lexer);
-						while (is_numeric(lexer->source[lexer->position])) {
-							increment_position(lexer);
-						}
+						advance_position(lexer, scan_numeric(lexer->source, lexer->position, lexer->source_length));
 
 						size_t number_end = lexer->position;
 						double extracted_decimal = extract_decimal(lexer->source, number_start, number_end);
@@ -403,7 +494,7 @@ Token_Data lexer_next(Lexer *lexer, bool advance) {
 						result = (Token_Data) {
 							.kind = DECIMAL,
 							.decimal = extracted_decimal,
-							.location = { .path_ref = lexer->path_ref, .row = number_start_row, .column = number_start_column }
+							.location = location_at(lexer, lexer->token_start)
 						};
 					} else {
 						size_t number_end = lexer->position;
@@ -412,7 +503,7 @@ Token_Data lexer_next(Lexer *lexer, bool advance) {
 						result = (Token_Data) {
 							.kind = INTEGER,
 							.integer = extracted_integer,
-							.location = { .path_ref = lexer->path_ref, .row = number_start_row, .column = number_start_column }
+							.location = location_at(lexer, lexer->token_start)
 						};
 					}
 				} else {
@@ -436,12 +527,74 @@ Token_Data lexer_next(Lexer *lexer, bool advance) {
 		}
 	}
 
-	if (!advance) {
-		lexer->cached_token = result;
-		lexer->has_cached = true;
+	return result;
+}
+
+void lexer_tokenize(Lexer *lexer) {
+	Token_Buffer *tokens = &lexer->tokens;
+	size_t capacity = lexer->source_length / 4 + 16;
+	arrsetcap(tokens->kinds, capacity);
+	arrsetcap(tokens->locations, capacity);
+	arrsetcap(tokens->values, capacity);
+
+	while (true) {
+		Token_Data token = lexer_next(lexer);
+
+		Token_Value value = {};
+		switch (token.kind) {
+			case IDENTIFIER:
+			case STRING:
+			case CHARACTER:
+				value.string.offset = token.string.ptr - lexer->source;
+				value.string.length = token.string.len;
+				break;
+			case INTEGER:
+				value.integer = token.integer;
+				break;
+			case DECIMAL:
+				value.decimal = token.decimal;
+				break;
+			default:
+				break;
+		}
+
+		arrpush(tokens->kinds, token.kind);
+		arrpush(tokens->locations, token.location);
+		arrpush(tokens->values, value);
+
+		if (token.kind == END_OF_FILE) break;
+	}
+}
+
+Token_Data lexer_token(Lexer *lexer, size_t index) {
+	Token_Buffer *tokens = &lexer->tokens;
+	if (index >= arrlenu(tokens->kinds)) {
+		index = arrlenu(tokens->kinds) - 1;
 	}
 
-	return result;
+	Token_Data token = {
+		.kind = tokens->kinds[index],
+		.location = tokens->locations[index]
+	};
+
+	Token_Value value = tokens->values[index];
+	switch (token.kind) {
+		case IDENTIFIER:
+		case STRING:
+		case CHARACTER:
+			token.string = (String_View) { .ptr = lexer->source + value.string.offset, .len = value.string.length };
+			break;
+		case INTEGER:
+			token.integer = value.integer;
+			break;
+		case DECIMAL:
+			token.decimal = value.decimal;
+			break;
+		default:
+			break;
+	}
+
+	return token;
 }
 
 char *token_to_string(Token_Kind kind) {
@@ -492,6 +645,8 @@ char *token_to_string(Token_Kind kind) {
 			return "load";
 		case KEYWORD_MOD:
 			return "mod";
+		case KEYWORD_NOALIAS:
+			return "noalias";
 		case KEYWORD_NOT:
 			return "not";
 		case KEYWORD_OP:
@@ -506,6 +661,8 @@ char *token_to_string(Token_Kind kind) {
 			return "switch";
 		case KEYWORD_TAGGED_UNION:
 			return "tagged_union";
+		case KEYWORD_TAIL:
+			return "tail";
 		case KEYWORD_OR:
 			return "or";
 		case KEYWORD_UNION:
@@ -558,10 +715,14 @@ char *token_to_string(Token_Kind kind) {
 			return "<";
 		case LESS_EQUALS:
 			return "<=";
+		case LESS_LESS:
+			return "<<";
 		case GREATER:
 			return ">";
 		case GREATER_EQUALS:
 			return ">=";
+		case GREATER_GREATER:
+			return ">>";
 		case PERIOD:
 			return ".";
 		case PERIOD_PERIOD:
@@ -26,6 +26,7 @@ typedef enum {
 	KEYWORD_IS,
 	KEYWORD_LOAD,
 	KEYWORD_MOD,
+	KEYWORD_NOALIAS,
 	KEYWORD_NOT,
 	KEYWORD_OP,
 	KEYWORD_RETURN,
@@ -33,6 +34,7 @@ typedef enum {
 	KEYWORD_STRUCT,
 	KEYWORD_SWITCH,
 	KEYWORD_TAGGED_UNION,
+	KEYWORD_TAIL,
 	KEYWORD_OR,
 	KEYWORD_UNION,
 	KEYWORD_WHILE,
@@ -57,9 +59,11 @@ typedef enum {
 	EXCLAMATION_EQUALS,
 	GREATER,
 	GREATER_EQUALS,
+	GREATER_GREATER,
 	HASH,
 	LESS,
 	LESS_EQUALS,
+	LESS_LESS,
 	MINUS,
 	MINUS_ARROW,
 	MINUS_EQUALS,
@@ -92,21 +96,40 @@ typedef struct {
 	};
 } Token_Data;
 
+typedef union {
+	struct {
+		uint32_t offset;
+		uint32_t length;
+	} string;
+	long integer;
+	double decimal;
+} Token_Value;
+
+typedef struct {
+	Token_Kind *kinds; // stb_ds
+	Source_Location *locations; // stb_ds
+	Token_Value *values; // stb_ds
+} Token_Buffer;
+
 typedef struct {
 	char *source;
 	size_t source_length;
 	size_t position;
-	char *path;
-	size_t row;
-	size_t column;
-	Token_Data cached_token;
-	bool has_cached;
-	uint32_t path_ref;
-	bool constant_row_column;
+	size_t token_start;
+	uint32_t source_start;
+	Data *data;
+	bool constant_location;
+	Source_Location location;
+	Token_Buffer tokens;
+	size_t token_index;
+	char *scratch; // stb_ds
 } Lexer;
 
-Lexer lexer_create(char *source, size_t source_length, uint32_t path_ref);
+Lexer lexer_create(char *source, size_t source_length, uint32_t source_start);
+
+Token_Data lexer_next(Lexer *lexer);
 
-Token_Data lexer_next(Lexer *lexer, bool advance);
+void lexer_tokenize(Lexer *lexer);
+Token_Data lexer_token(Lexer *lexer, size_t index);
 
 char *token_to_string(Token_Kind kind);
@@ -7,21 +7,19 @@
 #include <llvm-c/Analysis.h>
 #include <llvm-c/Types.h>
 #include <llvm-c/Core.h>
+#include <llvm-c/DebugInfo.h>
 #include <llvm-c/Target.h>
 #include <llvm-c/TargetMachine.h>
+#include <llvm-c/Transforms/PassBuilder.h>
 
 #include "ast.h"
+#include "evaluator.h"
 #include "stb/ds.h"
 #include "util.h"
 #include "value.h"
 
 #include "llvm_codegen.h"
 
-typedef struct {
-	LLVMBasicBlockRef block;
-	LLVMValueRef value;
-} Block_Codegen_Data;
-
 typedef struct {
 	LLVMBasicBlockRef block;
 	LLVMValueRef value;
@@ -39,24 +37,118 @@ typedef struct {
 	LLVMValueRef binding;
 } Catch_Codegen_Data;
 
-typedef struct { Node *key; LLVMValueRef value; } *State_Variables;
+typedef union {
+	LLVMValueRef variable;
+	While_Codegen_Data while_;
+	For_Codegen_Data for_;
+	If_Codegen_Data if_;
+	Catch_Codegen_Data catch;
+} Slot_Codegen_Data;
+
+typedef struct {
+	Value_Data *type;
+	LLVMTypeRef llvm_type;
+} Named_Struct;
+
+typedef enum {
+	TBAA_CHAR,
+	TBAA_BOOLEAN,
+	TBAA_INTEGER_16,
+	TBAA_INTEGER_32,
+	TBAA_INTEGER_64,
+	TBAA_FLOAT_32,
+	TBAA_FLOAT_64,
+	TBAA_POINTER,
+	TBAA_TYPE_COUNT,
+	TBAA_NONE = TBAA_TYPE_COUNT
+} Tbaa_Type;
+
+static const char *tbaa_type_names[TBAA_TYPE_COUNT] = {
+	"omnipotent char",
+	"bool",
+	"int16",
+	"int32",
+	"int64",
+	"float32",
+	"float64",
+	"any pointer"
+};
+
+typedef enum {
+	TAG_FIELD,
+	TAG_NULL_POINTER,
+	TAG_SPARE_VALUES
+} Tag_Kind;
+
+// Optionals, results and tagged unions are all a tag picking one of several variants, each with an optional payload
+typedef struct {
+	Tag_Kind kind;
+	Value_Data **payloads; // stb_ds, NULL for variants without one
+	LLVMTypeRef type;
+	LLVMTypeRef tag_type;
+	LLVMTypeRef payload_type;
+	size_t niche_variant; // the one variant with data when the tag lives in a niche of its payload
+	uint64_t spare_start; // first enum value past the last item, variant i is encoded as spare_start + i
+} Tag_Layout;
+
+// Lives across the size queries made while processing and the final build, so types are built once per LLVM context
+typedef struct {
+	LLVMContextRef context;
+	LLVMModuleRef module;
+	LLVMTargetMachineRef target_machine;
+	LLVMTargetDataRef target_data;
+	struct { Value_Data *key; LLVMTypeRef value; } *types; // stb_ds
+	struct { Node *key; Named_Struct *value; } *named_structs; // stb_ds
+	LLVMMetadataRef tbaa_types[TBAA_TYPE_COUNT];
+	LLVMMetadataRef tbaa_tags[TBAA_TYPE_COUNT];
+	struct { Value_Data *key; Tag_Layout value; } *tag_layouts; // stb_ds
+	bool fast_math;
+	bool optimize;
+} LLVM_Data;
+
+typedef enum {
+	ABI_DIRECT,
+	ABI_COERCE,
+	ABI_INDIRECT
+} Abi_Kind;
+
+// How a single language level value crosses a call boundary
+typedef struct {
+	Abi_Kind kind;
+	LLVMTypeRef type;
+	LLVMTypeRef parts[2]; // ABI_COERCE, passed as separate parameters
+	unsigned int part_count;
+	unsigned int index; // first LLVM parameter
+	const char *extension;
+	bool noalias;
+	uint64_t pointee_size;
+} Abi_Value;
+
+typedef struct {
+	Abi_Value *arguments; // stb_ds, one per non static argument
+	Abi_Value return_;
+	bool returns;
+	bool c_abi;
+	unsigned int integer_registers; // left over for variadic arguments
+	unsigned int sse_registers;
+	LLVMTypeRef llvm_type;
+} Function_Abi;
 
 typedef struct {
 	LLVMModuleRef llvm_module;
 	LLVMBuilderRef llvm_builder;
 	LLVMTargetMachineRef llvm_target;
 	LLVMContextRef llvm_context;
+	LLVMBuilderRef llvm_alloca_builder;
+	LLVM_Data *llvm_data;
 	Context context;
 	struct { Value_Data *key; LLVMValueRef value; } *generated_cache; // stb_ds
-	State_Variables variables; // stb_ds
-	struct { Node_Data *key; Block_Codegen_Data value; } *blocks; // stb_ds
-	struct { Node_Data *key; While_Codegen_Data value; } *whiles; // stb_ds
-	struct { Node_Data *key; For_Codegen_Data value; } *fors; // stb_ds
-	struct { Node_Data *key; If_Codegen_Data value; } *ifs; // stb_ds
-	struct { Node_Data *key; Catch_Codegen_Data value; } *catchs; // stb_ds
-	struct { Value_Data *key; LLVMValueRef value; } *globals; // stb_ds
+	struct { Node *key; LLVMValueRef value; } *extern_functions; // stb_ds
+	Function_Abi *function_abi;
+	Slot_Codegen_Data *slots; // stb_ds, indexed by Node_Data slot
 	LLVMValueRef *function_arguments; // stb_ds
-	LLVMValueRef context_var;
+	LLVMValueRef context_var; // set up on first use, see get_context_var
+	bool copy_context;
 	LLVMValueRef current_function;
 	LLVMValueRef main_function;
 	bool main_takes_arguments;
@@ -66,29 +158,650 @@ static LLVMValueRef generate_node(Node *node, State *state);
 static LLVMValueRef generate_value(Value_Data *value, Value_Data *type, State *state);
 
 static LLVMTypeRef create_llvm_type(Value_Data *node, State *state);
+static LLVMValueRef generate_extern_function(Value_Data *value, State *state);
 
-static LLVMTypeRef create_llvm_function_literal_type(Value_Data *value, State *state) {
+// Size of the storage behind a pointer value, or 0 when it is unknown; pointers can still be null so this is only ever a dereferenceable_or_null
+static uint64_t get_pointee_size(Value_Data *type, State *state) {
+	if (type->tag == OPTIONAL_TYPE_VALUE) type = type->optional_type.inner.value;
+	if (type->tag != POINTER_TYPE_VALUE) return 0;
+
+	Value_Data *inner = type->pointer_type.inner.value;
+	if (inner == NULL || inner->tag == FUNCTION_TYPE_VALUE) return 0;
+	if (inner->tag == ARRAY_TYPE_VALUE && inner->array_type.size.value == NULL) return 0;
+
+	return LLVMABISizeOfType(state->llvm_data->target_data, create_llvm_type(inner, state));
+}
+
+typedef enum {
+	EIGHTBYTE_NONE,
+	EIGHTBYTE_INTEGER,
+	EIGHTBYTE_SSE
+} Eightbyte_Class;
+
+typedef struct {
+	Eightbyte_Class classes[2];
+	LLVMTypeRef scalars[2]; // the scalar filling the eightbyte, when it is the only one
+	unsigned int scalar_counts[2];
+} Eightbytes;
+
+static void classify_eightbytes(LLVMTargetDataRef target_data, LLVMTypeRef type, uint64_t offset, Eightbytes *eightbytes) {
+	switch (LLVMGetTypeKind(type)) {
+		case LLVMStructTypeKind: {
+			for (unsigned int i = 0; i < LLVMCountStructElementTypes(type); i++) {
+				classify_eightbytes(target_data, LLVMStructGetTypeAtIndex(type, i), offset + LLVMOffsetOfElement(target_data, type, i), eightbytes);
+			}
+			break;
+		}
+		case LLVMArrayTypeKind: {
+			LLVMTypeRef element_type = LLVMGetElementType(type);
+			uint64_t stride = LLVMABISizeOfType(target_data, element_type);
+			for (unsigned int i = 0; i < LLVMGetArrayLength(type); i++) {
+				classify_eightbytes(target_data, element_type, offset + i * stride, eightbytes);
+			}
+			break;
+		}
+		default: {
+			// Fields are naturally aligned, so a scalar never straddles two eightbytes
+			size_t i = offset / 8;
+			LLVMTypeKind kind = LLVMGetTypeKind(type);
+			if (kind == LLVMFloatTypeKind || kind == LLVMDoubleTypeKind) {
+				if (eightbytes->classes[i] == EIGHTBYTE_NONE) eightbytes->classes[i] = EIGHTBYTE_SSE;
+			} else {
+				eightbytes->classes[i] = EIGHTBYTE_INTEGER;
+			}
+			eightbytes->scalars[i] = type;
+			eightbytes->scalar_counts[i]++;
+			break;
+		}
+	}
+}
+
+static const char *get_extension(Value_Data *type) {
+	switch (type->tag) {
+		case INTEGER_TYPE_VALUE:
+			if (type->integer_type.size >= 32) return NULL;
+			return type->integer_type.signed_ ? "signext" : "zeroext";
+		case BOOLEAN_TYPE_VALUE:
+		case BYTE_TYPE_VALUE:
+			return "zeroext";
+		default:
+			return NULL;
+	}
+}
+
+// Aggregates are passed by pointer once they no longer fit two registers, and the C ABI additionally coerces small ones into eightbytes like SysV x86-64
+static Abi_Value classify_llvm_value(LLVMTypeRef type, bool c_abi, State *state) {
+	Abi_Value result = { .kind = ABI_DIRECT, .type = type };
+
+	LLVMTypeKind kind = LLVMGetTypeKind(type);
+	if (kind != LLVMStructTypeKind && kind != LLVMArrayTypeKind) return result;
+
+	uint64_t size = LLVMABISizeOfType(state->llvm_data->target_data, type);
+	if (size > 16) {
+		result.kind = ABI_INDIRECT;
+		return result;
+	}
+	if (!c_abi || size == 0) return result;
+
+	Eightbytes eightbytes = {};
+	classify_eightbytes(state->llvm_data->target_data, type, 0, &eightbytes);
+
+	result.kind = ABI_COERCE;
+	result.part_count = (size + 7) / 8;
+	for (unsigned int i = 0; i < result.part_count; i++) {
+		uint64_t covered = size - i * 8 < 8 ? size - i * 8 : 8;
+		if (eightbytes.scalar_counts[i] == 1 && LLVMABISizeOfType(state->llvm_data->target_data, eightbytes.scalars[i]) == covered) {
+			result.parts[i] = eightbytes.scalars[i];
+		} else if (eightbytes.classes[i] == EIGHTBYTE_SSE) {
+			result.parts[i] = covered <= 4 ? LLVMFloatTypeInContext(state->llvm_context) : LLVMVectorType(LLVMFloatTypeInContext(state->llvm_context), 2);
+		} else {
+			result.parts[i] = LLVMIntTypeInContext(state->llvm_context, covered * 8);
+		}
+	}
+
+	return result;
+}
+
+static Abi_Value classify_value(Value_Data *type, bool c_abi, State *state) {
+	Abi_Value result = classify_llvm_value(create_llvm_type(type, state), c_abi, state);
+	if (c_abi) result.extension = get_extension(type);
+	result.pointee_size = get_pointee_size(type, state);
+	return result;
+}
+
+// Arguments that would need more registers than are left go to the stack as a whole
+static void assign_registers(Abi_Value *value, Function_Abi *abi) {
+	unsigned int integer_count = 0;
+	unsigned int sse_count = 0;
+	if (value->kind == ABI_DIRECT) {
+		LLVMTypeKind kind = LLVMGetTypeKind(value->type);
+		if (kind == LLVMFloatTypeKind || kind == LLVMDoubleTypeKind) sse_count++;
+		else integer_count++;
+	} else if (value->kind == ABI_COERCE) {
+		for (unsigned int i = 0; i < value->part_count; i++) {
+			LLVMTypeKind kind = LLVMGetTypeKind(value->parts[i]);
+			if (kind == LLVMFloatTypeKind || kind == LLVMDoubleTypeKind || kind == LLVMVectorTypeKind) sse_count++;
+			else integer_count++;
+		}
+	}
+
+	if (integer_count > abi->integer_registers || sse_count > abi->sse_registers) {
+		if (value->kind == ABI_COERCE) value->kind = ABI_INDIRECT;
+		return;
+	}
+	abi->integer_registers -= integer_count;
+	abi->sse_registers -= sse_count;
+}
+
+static void push_abi_parameters(Abi_Value *value, LLVMTypeRef **parameters, State *state) {
+	value->index = arrlen(*parameters);
+	switch (value->kind) {
+		case ABI_DIRECT:
+			arrpush(*parameters, value->type);
+			break;
+		case ABI_COERCE:
+			for (unsigned int i = 0; i < value->part_count; i++) {
+				arrpush(*parameters, value->parts[i]);
+			}
+			break;
+		case ABI_INDIRECT:
+			arrpush(*parameters, LLVMPointerType(LLVMInt8TypeInContext(state->llvm_context), 0));
+			break;
+	}
+}
+
+// Extern functions follow the C ABI and take no context, everything else passes the context last
+static Function_Abi get_function_abi(Value_Data *value, bool c_abi, State *state) {
 	assert(value->tag == FUNCTION_TYPE_VALUE);
 	Function_Type_Value function_type = value->function_type;
 
-	LLVMTypeRef *arguments = NULL;
+	Function_Abi abi = {
+		.c_abi = c_abi,
+		.integer_registers = 6,
+		.sse_registers = 8
+	};
+
+	LLVMTypeRef *parameters = NULL;
+
+	LLVMTypeRef return_type = LLVMVoidTypeInContext(state->llvm_context);
+	if (function_type.return_type.value != NULL) {
+		abi.returns = true;
+		abi.return_ = classify_value(function_type.return_type.value, c_abi, state);
+		switch (abi.return_.kind) {
+			case ABI_DIRECT:
+				return_type = abi.return_.type;
+				break;
+			case ABI_COERCE:
+				return_type = abi.return_.part_count == 1 ? abi.return_.parts[0] : LLVMStructTypeInContext(state->llvm_context, abi.return_.parts, abi.return_.part_count, false);
+				break;
+			case ABI_INDIRECT:
+				arrpush(parameters, LLVMPointerType(LLVMInt8TypeInContext(state->llvm_context), 0));
+				abi.integer_registers--;
+				break;
+		}
+	}
 
 	for (long int i = 0; i < arrlen(function_type.arguments); i++) {
-		if (function_type.arguments[i].static_) continue;
-		arrpush(arguments, create_llvm_type(function_type.arguments[i].type.value, state));
+		Function_Argument_Value argument = function_type.arguments[i];
+		if (argument.static_) continue;
+
+		Abi_Value argument_abi = classify_value(argument.type.value, c_abi, state);
+		argument_abi.noalias = argument.noalias;
+
+		// A noalias array view is passed as separate length and data arguments so the data pointer itself can be marked noalias
+		if (argument.noalias && argument.type.value->tag == ARRAY_VIEW_TYPE_VALUE && argument_abi.kind == ABI_DIRECT) {
+			argument_abi.kind = ABI_COERCE;
+			argument_abi.part_count = 2;
+			argument_abi.parts[0] = LLVMStructGetTypeAtIndex(argument_abi.type, 0);
+			argument_abi.parts[1] = LLVMStructGetTypeAtIndex(argument_abi.type, 1);
+		}
+
+		if (c_abi) assign_registers(&argument_abi, &abi);
+		push_abi_parameters(&argument_abi, &parameters, state);
+		arrpush(abi.arguments, argument_abi);
 	}
 
-	arrpush(arguments, LLVMPointerType(LLVMVoidTypeInContext(state->llvm_context), 0));
+	if (!c_abi) {
+		arrpush(parameters, LLVMPointerType(LLVMVoidTypeInContext(state->llvm_context), 0));
+	}
 
-	LLVMTypeRef return_type = LLVMVoidTypeInContext(state->llvm_context);
-	if (function_type.return_type.value != NULL) {
-		return_type = create_llvm_type(function_type.return_type.value, state);
+	abi.llvm_type = LLVMFunctionType(return_type, parameters, arrlen(parameters), function_type.variadic);
+	return abi;
+}
+
+static LLVMTypeRef create_llvm_function_literal_type(Value_Data *value, State *state) {
+	return get_function_abi(value, false, state).llvm_type;
+}
+
+static Slot_Codegen_Data *get_slot(State *state, Node_Data *data) {
+	size_t length = arrlenu(state->slots);
+	if (data->slot >= length) {
+		arrsetlen(state->slots, data->slot + 1);
+		memset(state->slots + length, 0, sizeof(Slot_Codegen_Data) * (data->slot + 1 - length));
 	}
 
-	return LLVMFunctionType(return_type, arguments, arrlen(arguments), function_type.variadic);
+	return &state->slots[data->slot];
+}
+
+static LLVMTypeRef create_llvm_type_uncached(Value_Data *value, State *state);
+
+static Tbaa_Type get_tbaa_type(Value_Data *type) {
+	switch (type->tag) {
+		case BYTE_TYPE_VALUE:
+			return TBAA_CHAR;
+		case BOOLEAN_TYPE_VALUE:
+			return TBAA_BOOLEAN;
+		case ENUM_TYPE_VALUE:
+			return TBAA_INTEGER_64;
+		case INTEGER_TYPE_VALUE:
+			switch (type->integer_type.size) {
+				case 8:
+					return TBAA_CHAR;
+				case 16:
+					return TBAA_INTEGER_16;
+				case 32:
+					return TBAA_INTEGER_32;
+				case 64:
+					return TBAA_INTEGER_64;
+				default:
+					return TBAA_NONE;
+			}
+		case FLOAT_TYPE_VALUE:
+			switch (type->float_type.size) {
+				case 32:
+					return TBAA_FLOAT_32;
+				case 64:
+					return TBAA_FLOAT_64;
+				default:
+					return TBAA_NONE;
+			}
+		case POINTER_TYPE_VALUE:
+			return TBAA_POINTER;
+		default:
+			return TBAA_NONE;
+	}
+}
+
+// Scalar type tree shaped like C's, with every type under char so byte accesses may still alias anything. This is
+// sound because the processor only allows pointer casts between types that alias, see pointees_may_alias
+static void annotate_tbaa(State *state, LLVMValueRef instruction, Value_Data *type) {
+	Tbaa_Type tbaa_type = get_tbaa_type(type);
+	if (tbaa_type == TBAA_NONE) return;
+
+	LLVM_Data *llvm_data = state->llvm_data;
+	LLVMContextRef llvm_context = state->llvm_context;
+	if (llvm_data->tbaa_tags[tbaa_type] == NULL) {
+		LLVMMetadataRef zero = LLVMValueAsMetadata(LLVMConstInt(LLVMInt64TypeInContext(llvm_context), 0, false));
+		if (llvm_data->tbaa_types[TBAA_CHAR] == NULL) {
+			LLVMMetadataRef root_name = LLVMMDStringInContext2(llvm_context, "lang tbaa", 9);
+			LLVMMetadataRef char_type[3] = {
+				LLVMMDStringInContext2(llvm_context, tbaa_type_names[TBAA_CHAR], strlen(tbaa_type_names[TBAA_CHAR])),
+				LLVMMDNodeInContext2(llvm_context, &root_name, 1),
+				zero
+			};
+			llvm_data->tbaa_types[TBAA_CHAR] = LLVMMDNodeInContext2(llvm_context, char_type, 3);
+		}
+
+		if (llvm_data->tbaa_types[tbaa_type] == NULL) {
+			LLVMMetadataRef scalar_type[3] = {
+				LLVMMDStringInContext2(llvm_context, tbaa_type_names[tbaa_type], strlen(tbaa_type_names[tbaa_type])),
+				llvm_data->tbaa_types[TBAA_CHAR],
+				zero
+			};
+			llvm_data->tbaa_types[tbaa_type] = LLVMMDNodeInContext2(llvm_context, scalar_type, 3);
+		}
+
+		LLVMMetadataRef tag[3] = {
+			llvm_data->tbaa_types[tbaa_type],
+			llvm_data->tbaa_types[tbaa_type],
+			zero
+		};
+		llvm_data->tbaa_tags[tbaa_type] = LLVMMDNodeInContext2(llvm_context, tag, 3);
+	}
+
+	LLVMSetMetadata(instruction, LLVMGetMDKindIDInContext(llvm_context, "tbaa", 4), LLVMMetadataAsValue(llvm_context, llvm_data->tbaa_tags[tbaa_type]));
+}
+
+// Walks the blocks between entering the body and leaving the loop, looking for calls that aren't intrinsics
+static bool loop_has_calls(LLVMBasicBlockRef body_block, LLVMBasicBlockRef check_block, LLVMBasicBlockRef done_block) {
+	LLVMBasicBlockRef *worklist = NULL;
+	struct { LLVMBasicBlockRef key; bool value; } *visited = NULL;
+	hmput(visited, check_block, true);
+	hmput(visited, done_block, true);
+	arrpush(worklist, body_block);
+
+	while (arrlen(worklist) > 0) {
+		LLVMBasicBlockRef block = arrpop(worklist);
+		if (hmget(visited, block)) continue;
+		hmput(visited, block, true);
+
+		for (LLVMValueRef instruction = LLVMGetFirstInstruction(block); instruction != NULL; instruction = LLVMGetNextInstruction(instruction)) {
+			if (LLVMIsACallInst(instruction) == NULL) continue;
+
+			LLVMValueRef callee = LLVMGetCalledValue(instruction);
+			if (LLVMIsAFunction(callee) == NULL || LLVMGetIntrinsicID(callee) == 0) return true;
+		}
+
+		LLVMValueRef terminator = LLVMGetBasicBlockTerminator(block);
+		if (terminator == NULL) continue;
+		for (unsigned int i = 0; i < LLVMGetNumSuccessors(terminator); i++) {
+			arrpush(worklist, LLVMGetSuccessor(terminator, i));
+		}
+	}
+
+	return false;
+}
+
+// For loops always terminate, so their back edge can promise forward progress. Vectorization is only requested for
+// loops without calls, since LLVM warns about every requested loop it can't vectorize
+static void annotate_for_loop(State *state, LLVMValueRef back_edge, bool vectorize) {
+	LLVMContextRef llvm_context = state->llvm_context;
+
+	LLVMMetadataRef progress_name = LLVMMDStringInContext2(llvm_context, "llvm.loop.mustprogress", 22);
+	LLVMMetadataRef vectorize_enable[2] = {
+		LLVMMDStringInContext2(llvm_context, "llvm.loop.vectorize.enable", 26),
+		LLVMValueAsMetadata(LLVMConstInt(LLVMInt1TypeInContext(llvm_context), 1, false))
+	};
+
+	LLVMMetadataRef temporary = LLVMTemporaryMDNode(llvm_context, NULL, 0);
+	LLVMMetadataRef items[3] = {
+		temporary,
+		LLVMMDNodeInContext2(llvm_context, &progress_name, 1),
+		LLVMMDNodeInContext2(llvm_context, vectorize_enable, 2)
+	};
+	LLVMMetadataRef loop = LLVMMDNodeInContext2(llvm_context, items, vectorize ? 3 : 2);
+	LLVMMetadataReplaceAllUsesWith(temporary, loop);
+
+	LLVMSetMetadata(back_edge, LLVMGetMDKindIDInContext(llvm_context, "llvm.loop", 9), LLVMMetadataAsValue(llvm_context, loop));
+}
+
+// Functions that only read the context use the caller's by reference, and only those that assign to it or take its address get a private copy
+static LLVMValueRef get_context_var(State *state) {
+	if (state->context_var == NULL) {
+		LLVMValueRef context_parameter = LLVMGetParam(state->current_function, LLVMCountParams(state->current_function) - 1);
+		if (state->copy_context) {
+			LLVMTypeRef context_type = create_llvm_type(state->context.context_type.value, state);
+			LLVMBasicBlockRef entry = LLVMGetEntryBasicBlock(state->current_function);
+			LLVMValueRef first = LLVMGetFirstInstruction(entry);
+			if (first != NULL) {
+				LLVMPositionBuilderBefore(state->llvm_alloca_builder, first);
+			} else {
+				LLVMPositionBuilderAtEnd(state->llvm_alloca_builder, entry);
+			}
+
+			state->context_var = LLVMBuildAlloca(state->llvm_alloca_builder, context_type, "");
+			LLVMBuildStore(state->llvm_alloca_builder, LLVMBuildLoad2(state->llvm_alloca_builder, context_type, context_parameter, ""), state->context_var);
+		} else {
+			state->context_var = context_parameter;
+		}
+	}
+
+	return state->context_var;
+}
+
+// Stack slots always go to the top of the entry block so they are allocated once per call and can be promoted to registers
+static LLVMValueRef build_alloca(State *state, LLVMTypeRef type) {
+	LLVMValueRef function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(state->llvm_builder));
+	LLVMBasicBlockRef entry = LLVMGetEntryBasicBlock(function);
+	LLVMValueRef first = LLVMGetFirstInstruction(entry);
+	if (first != NULL) {
+		LLVMPositionBuilderBefore(state->llvm_alloca_builder, first);
+	} else {
+		LLVMPositionBuilderAtEnd(state->llvm_alloca_builder, entry);
+	}
+
+	return LLVMBuildAlloca(state->llvm_alloca_builder, type, "");
 }
 
 static LLVMTypeRef create_llvm_type(Value_Data *value, State *state) {
+	LLVM_Data *llvm_data = state->llvm_data;
+	LLVMTypeRef llvm_type = hmget(llvm_data->types, value);
+	if (llvm_type == NULL) {
+		llvm_type = create_llvm_type_uncached(value, state);
+		hmput(llvm_data->types, value, llvm_type);
+	}
+
+	return llvm_type;
+}
+
+// Identified structs are nominal in LLVM, so every equal instance of a struct type has to map to the same one
+static LLVMTypeRef create_llvm_struct_type(Value_Data *value, State *state) {
+	LLVM_Data *llvm_data = state->llvm_data;
+	Struct_Type_Value struct_type = value->struct_type;
+
+	Named_Struct *named_structs = hmget(llvm_data->named_structs, struct_type.node);
+	for (long int i = 0; i < arrlen(named_structs); i++) {
+		if (value_equal(named_structs[i].type, value)) {
+			return named_structs[i].llvm_type;
+		}
+	}
+
+	String_View name = struct_type.node->struct_type.name;
+	char *name_buffer = malloc(name.len + 1);
+	memcpy(name_buffer, name.ptr, name.len);
+	name_buffer[name.len] = '\0';
+
+	LLVMTypeRef llvm_type = LLVMStructCreateNamed(state->llvm_context, name_buffer);
+	free(name_buffer);
+
+	Named_Struct named_struct = {
+		.type = value,
+		.llvm_type = llvm_type
+	};
+	arrpush(named_structs, named_struct);
+	hmput(llvm_data->named_structs, struct_type.node, named_structs);
+
+	LLVMTypeRef *items = NULL;
+	for (long int i = 0; i < arrlen(struct_type.members); i++) {
+		arrpush(items, create_llvm_type(struct_type.members[i].value, state));
+	}
+	LLVMStructSetBody(llvm_type, items, arrlen(items), false);
+
+	return llvm_type;
+}
+
+// Empty payloads and single item enums always hold the same value, so storing them is unnecessary
+static bool payload_carries_data(Value_Data *payload, State *state) {
+	if (payload == NULL) return false;
+	if (payload->tag == ENUM_TYPE_VALUE && arrlen(payload->enum_type.items) == 1) return false;
+	return LLVMABISizeOfType(state->llvm_data->target_data, create_llvm_type(payload, state)) > 0;
+}
+
+static Tag_Layout compute_tag_layout(Value_Data *type, State *state) {
+	Tag_Layout layout = { .kind = TAG_FIELD };
+	switch (type->tag) {
+		case OPTIONAL_TYPE_VALUE:
+			arrpush(layout.payloads, NULL);
+			arrpush(layout.payloads, type->optional_type.inner.value);
+			break;
+		case RESULT_TYPE_VALUE:
+			arrpush(layout.payloads, type->result_type.value.value);
+			arrpush(layout.payloads, type->result_type.error.value);
+			break;
+		case TAGGED_UNION_TYPE_VALUE:
+			for (long int i = 0; i < arrlen(type->tagged_union_type.items); i++) {
+				arrpush(layout.payloads, type->tagged_union_type.items[i].type.value);
+			}
+			break;
+		default:
+			assert(false);
+	}
+
+	size_t variant_count = arrlen(layout.payloads);
+	size_t data_count = 0;
+	for (size_t i = 0; i < variant_count; i++) {
+		if (payload_carries_data(layout.payloads[i], state)) {
+			layout.niche_variant = i;
+			data_count++;
+		}
+	}
+
+	// With a single variant holding data, the others can be encoded as values its payload never takes
+	if (data_count == 1) {
+		Value_Data *payload = layout.payloads[layout.niche_variant];
+		// null is a valid *T, so only an optional, where null is how none is written, can reuse it as the tag
+		if (payload->tag == POINTER_TYPE_VALUE && type->tag == OPTIONAL_TYPE_VALUE) {
+			layout.kind = TAG_NULL_POINTER;
+			layout.type = create_llvm_type(payload, state);
+			return layout;
+		} else if (payload->tag == ENUM_TYPE_VALUE) {
+			layout.kind = TAG_SPARE_VALUES;
+			layout.type = create_llvm_type(payload, state);
+			layout.spare_start = arrlen(payload->enum_type.items);
+			return layout;
+		}
+	}
+
+	unsigned int tag_bits = 64;
+	if (variant_count <= 2) tag_bits = 1;
+	else if (variant_count <= UINT8_MAX + 1) tag_bits = 8;
+	else if (variant_count <= UINT16_MAX + 1) tag_bits = 16;
+	else if (variant_count <= (size_t) UINT32_MAX + 1) tag_bits = 32;
+	layout.tag_type = LLVMIntTypeInContext(state->llvm_context, tag_bits);
+
+	// The payload is typed as its most aligned variant so the whole value keeps that alignment, and padded to the largest one
+	LLVMTypeRef member = NULL;
+	size_t max_size = 0;
+	for (size_t i = 0; i < variant_count; i++) {
+		if (!payload_carries_data(layout.payloads[i], state)) continue;
+
+		LLVMTypeRef payload_type = create_llvm_type(layout.payloads[i], state);
+		size_t size = LLVMABISizeOfType(state->llvm_data->target_data, payload_type);
+		if (size > max_size) max_size = size;
+
+		if (member == NULL) {
+			member = payload_type;
+			continue;
+		}
+
+		unsigned int alignment = LLVMABIAlignmentOfType(state->llvm_data->target_data, payload_type);
+		unsigned int member_alignment = LLVMABIAlignmentOfType(state->llvm_data->target_data, member);
+		if (alignment > member_alignment || (alignment == member_alignment && size > LLVMABISizeOfType(state->llvm_data->target_data, member))) {
+			member = payload_type;
+		}
+	}
+
+	if (member == NULL) {
+		layout.payload_type = LLVMStructTypeInContext(state->llvm_context, NULL, 0, false);
+	} else {
+		size_t member_size = LLVMABISizeOfType(state->llvm_data->target_data, member);
+		if (member_size < max_size) {
+			LLVMTypeRef items[2] = {
+				member,
+				LLVMArrayType(LLVMInt8TypeInContext(state->llvm_context), max_size - member_size)
+			};
+			layout.payload_type = LLVMStructTypeInContext(state->llvm_context, items, 2, false);
+		} else {
+			layout.payload_type = member;
+		}
+	}
+
+	LLVMTypeRef items[2] = { layout.tag_type, layout.payload_type };
+	layout.type = LLVMStructTypeInContext(state->llvm_context, items, 2, false);
+	return layout;
+}
+
+static Tag_Layout get_tag_layout(Value_Data *type, State *state) {
+	LLVM_Data *llvm_data = state->llvm_data;
+	long int index = hmgeti(llvm_data->tag_layouts, type);
+	if (index >= 0) return llvm_data->tag_layouts[index].value;
+
+	Tag_Layout layout = compute_tag_layout(type, state);
+	hmput(llvm_data->tag_layouts, type, layout);
+	return layout;
+}
+
+static LLVMValueRef build_tag_check(Value_Data *type, LLVMValueRef value, size_t variant, State *state) {
+	Tag_Layout layout = get_tag_layout(type, state);
+	switch (layout.kind) {
+		case TAG_FIELD: {
+			LLVMValueRef tag = LLVMBuildExtractValue(state->llvm_builder, value, 0, "");
+			return LLVMBuildICmp(state->llvm_builder, LLVMIntEQ, tag, LLVMConstInt(layout.tag_type, variant, false), "");
+		}
+		case TAG_NULL_POINTER: {
+			LLVMIntPredicate predicate = variant == layout.niche_variant ? LLVMIntNE : LLVMIntEQ;
+			return LLVMBuildICmp(state->llvm_builder, predicate, value, LLVMConstNull(layout.type), "");
+		}
+		case TAG_SPARE_VALUES: {
+			if (variant == layout.niche_variant) {
+				return LLVMBuildICmp(state->llvm_builder, LLVMIntULT, value, LLVMConstInt(layout.type, layout.spare_start, false), "");
+			}
+			return LLVMBuildICmp(state->llvm_builder, LLVMIntEQ, value, LLVMConstInt(layout.type, layout.spare_start + variant, false), "");
+		}
+	}
+
+	assert(false);
+	return NULL;
+}
+
+// The variant index as a 64 bit integer, matching the enum values of a tagged union
+static LLVMValueRef build_tag(Value_Data *type, LLVMValueRef value, State *state) {
+	Tag_Layout layout = get_tag_layout(type, state);
+	LLVMTypeRef int64_type = LLVMInt64TypeInContext(state->llvm_context);
+	switch (layout.kind) {
+		case TAG_FIELD:
+			return LLVMBuildZExt(state->llvm_builder, LLVMBuildExtractValue(state->llvm_builder, value, 0, ""), int64_type, "");
+		case TAG_NULL_POINTER:
+		case TAG_SPARE_VALUES: {
+			LLVMValueRef check = build_tag_check(type, value, layout.niche_variant, state);
+			LLVMValueRef other = layout.kind == TAG_SPARE_VALUES ? LLVMBuildSub(state->llvm_builder, value, LLVMConstInt(layout.type, layout.spare_start, false), "") : LLVMConstInt(int64_type, 1 - layout.niche_variant, false);
+			return LLVMBuildSelect(state->llvm_builder, check, LLVMConstInt(int64_type, layout.niche_variant, false), other, "");
+		}
+	}
+
+	assert(false);
+	return NULL;
+}
+
+static LLVMValueRef build_payload(Value_Data *type, LLVMValueRef value, size_t variant, State *state) {
+	Tag_Layout layout = get_tag_layout(type, state);
+	Value_Data *payload = layout.payloads[variant];
+	if (payload == NULL) return NULL;
+
+	LLVMTypeRef payload_type = create_llvm_type(payload, state);
+	if (!payload_carries_data(payload, state)) return LLVMConstNull(payload_type);
+	if (layout.kind != TAG_FIELD) return value;
+	if (payload_type == layout.payload_type) return LLVMBuildExtractValue(state->llvm_builder, value, 1, "");
+
+	LLVMValueRef storage = build_alloca(state, layout.type);
+	LLVMBuildStore(state->llvm_builder, value, storage);
+	LLVMValueRef payload_pointer = LLVMBuildStructGEP2(state->llvm_builder, layout.type, storage, 1, "");
+	return LLVMBuildLoad2(state->llvm_builder, payload_type, payload_pointer, "");
+}
+
+// A NULL payload is left undefined
+static LLVMValueRef build_variant(Value_Data *type, size_t variant, LLVMValueRef payload, State *state) {
+	Tag_Layout layout = get_tag_layout(type, state);
+	switch (layout.kind) {
+		case TAG_FIELD: {
+			LLVMValueRef tag = LLVMConstInt(layout.tag_type, variant, false);
+			if (payload == NULL || !payload_carries_data(layout.payloads[variant], state)) {
+				return LLVMBuildInsertValue(state->llvm_builder, LLVMGetUndef(layout.type), tag, 0, "");
+			}
+
+			if (LLVMTypeOf(payload) == layout.payload_type) {
+				LLVMValueRef value = LLVMBuildInsertValue(state->llvm_builder, LLVMGetUndef(layout.type), tag, 0, "");
+				return LLVMBuildInsertValue(state->llvm_builder, value, payload, 1, "");
+			}
+
+			LLVMValueRef storage = build_alloca(state, layout.type);
+			LLVMBuildStore(state->llvm_builder, tag, LLVMBuildStructGEP2(state->llvm_builder, layout.type, storage, 0, ""));
+			LLVMBuildStore(state->llvm_builder, payload, LLVMBuildStructGEP2(state->llvm_builder, layout.type, storage, 1, ""));
+			return LLVMBuildLoad2(state->llvm_builder, layout.type, storage, "");
+		}
+		case TAG_NULL_POINTER:
+			if (variant == layout.niche_variant) return payload != NULL ? payload : LLVMGetUndef(layout.type);
+			return LLVMConstNull(layout.type);
+		case TAG_SPARE_VALUES:
+			if (variant == layout.niche_variant) return payload != NULL ? payload : LLVMGetUndef(layout.type);
+			return LLVMConstInt(layout.type, layout.spare_start + variant, false);
+	}
+
+	assert(false);
+	return NULL;
+}
+
+static LLVMTypeRef create_llvm_type_uncached(Value_Data *value, State *state) {
 	switch (value->tag) {
 		case POINTER_TYPE_VALUE: {
 			// LLVM doesn't ever use a precise child type
@@ -103,6 +816,9 @@ static LLVMTypeRef create_llvm_type(Value_Data *value, State *state) {
 		}
 		case STRUCT_TYPE_VALUE: {
 			Struct_Type_Value struct_type = value->struct_type;
+			if (struct_type.node != NULL) {
+				return create_llvm_struct_type(value, state);
+			}
 
 			LLVMTypeRef *items = NULL;
 			for (long int i = 0; i < arrlen(struct_type.members); i++) {
@@ -126,48 +842,16 @@ static LLVMTypeRef create_llvm_type(Value_Data *value, State *state) {
 
 			size_t max_size = 0;
 			for (long int i = 0; i < arrlen(union_type.items); i++) {
-				size_t size = LLVMABISizeOfType(LLVMCreateTargetDataLayout(state->llvm_target), create_llvm_type(union_type.items[i].type.value, state));
+				size_t size = LLVMABISizeOfType(state->llvm_data->target_data, create_llvm_type(union_type.items[i].type.value, state));
 				if (size > max_size) max_size = size;
 			}
 
 			return LLVMArrayType(LLVMInt8TypeInContext(state->llvm_context), max_size);
 		}
-		case TAGGED_UNION_TYPE_VALUE: {
-			Tagged_Union_Type_Value tagged_union_type = value->tagged_union_type;
-
-			size_t max_size = 0;
-			for (long int i = 0; i < arrlen(tagged_union_type.items); i++) {
-				size_t size = LLVMABISizeOfType(LLVMCreateTargetDataLayout(state->llvm_target), create_llvm_type(tagged_union_type.items[i].type.value, state));
-				if (size > max_size) max_size = size;
-			}
-
-			LLVMTypeRef items[2] = {
-				LLVMInt64TypeInContext(state->llvm_context),
-				LLVMArrayType(LLVMInt8TypeInContext(state->llvm_context), max_size)
-			};
-
-			return LLVMStructTypeInContext(state->llvm_context, items, 2, false);
-		}
-		case RESULT_TYPE_VALUE: {
-			Result_Type_Value result_type = value->result_type;
-
-			size_t max_size = 0;
-			if (result_type.value.value != NULL) {
-				max_size = LLVMABISizeOfType(LLVMCreateTargetDataLayout(state->llvm_target), create_llvm_type(result_type.value.value, state));
-			}
-
-			size_t error_size = LLVMABISizeOfType(LLVMCreateTargetDataLayout(state->llvm_target), create_llvm_type(result_type.error.value, state));
-			if (error_size > max_size) {
-				max_size = error_size;
-			}
-
-			LLVMTypeRef items[2] = {
-				LLVMInt64TypeInContext(state->llvm_context),
-				LLVMArrayType(LLVMInt8TypeInContext(state->llvm_context), max_size)
-			};
-
-			return LLVMStructTypeInContext(state->llvm_context, items, 2, false);
-		}
+		case TAGGED_UNION_TYPE_VALUE:
+		case RESULT_TYPE_VALUE:
+		case OPTIONAL_TYPE_VALUE:
+			return get_tag_layout(value, state).type;
 		case ENUM_TYPE_VALUE: {
 			return LLVMInt64TypeInContext(state->llvm_context);
 		}
@@ -201,19 +885,6 @@ static LLVMTypeRef create_llvm_type(Value_Data *value, State *state) {
 			items[1] = LLVMPointerType(LLVMArrayType2(create_llvm_type(value->array_view_type.inner.value, state), 0), 0);
 			return LLVMStructTypeInContext(state->llvm_context, items, 2, false);
 		}
-		case OPTIONAL_TYPE_VALUE: {
-			Optional_Type_Value optional_type = value->optional_type;
-
-			LLVMTypeRef inner_type = create_llvm_type(optional_type.inner.value, state);
-			if (optional_type.inner.value->tag == POINTER_TYPE_VALUE) {
-				return inner_type;
-			} else {
-				LLVMTypeRef *items = malloc(sizeof(LLVMTypeRef) * 2);
-				items[0] = LLVMInt1TypeInContext(state->llvm_context);
-				items[1] = inner_type;
-				return LLVMStructTypeInContext(state->llvm_context, items, 2, false);
-			}
-		}
 		case RANGE_TYPE_VALUE: {
 			Range_Type_Value range_type = value->range_type;
 
@@ -235,67 +906,366 @@ static LLVMTypeRef create_llvm_type(Value_Data *value, State *state) {
 	}
 }
 
-static void generate_define(Node *node, State *state) {
-	assert(node->kind == DEFINE_NODE);
-	Define_Node define = node->define;
-	if (sv_eq_cstr(define.identifier, "main")) {
-		size_t saved_static_id = state->context.static_id;
-		state->context.static_id = 1;
-		Node_Data *data = get_data(&state->context, node);
-		state->context.static_id = saved_static_id;
-		if (data == NULL) {
-			return;
-		}
+static void generate_define(Node *node, State *state) {
+	assert(node->kind == DEFINE_NODE);
+	Define_Node define = node->define;
+	if (sv_eq_cstr(define.identifier, "main")) {
+		size_t saved_static_id = state->context.static_id;
+		state->context.static_id = 1;
+		Node_Data *data = get_data(&state->context, node);
+		state->context.static_id = saved_static_id;
+		if (data == NULL) {
+			return;
+		}
+
+		Typed_Value typed_value = data->define.typed_value;
+		if (typed_value.value.value == NULL) {
+			return;
+		}
+
+		LLVMValueRef llvm_value = generate_value(typed_value.value.value, typed_value.type.value, state);
+		state->main_function = llvm_value;
+		state->main_takes_arguments = arrlen(typed_value.value.value->function.type->function_type.arguments) > 0;
+	}
+}
+
+static LLVMValueRef generate_block(Node *node, State *state) {
+	assert(node->kind == BLOCK_NODE);
+	Block_Node block = node->block;
+	Block_Data block_data = get_data(&state->context, node)->block;
+
+	LLVMValueRef result = NULL;
+	for (long int i = 0; i < arrlen(block.statements); i++) {
+		if (block.statements[i]->kind == DEFER_NODE) continue;
+
+		LLVMValueRef value = generate_node(block.statements[i], state);
+		if (block.has_result && i == arrlen(block.statements) - 1) {
+			result = value;
+		}
+	}
+
+	for (long int i = 0; i < arrlen(block_data.defers); i++) {
+		generate_node(block_data.defers[i], state);
+	}
+
+	if (block.has_result) {
+		return result;
+	}
+	return NULL;
+}
+
+static LLVMAttributeRef create_attribute(State *state, const char *name, uint64_t value) {
+	return LLVMCreateEnumAttribute(state->llvm_context, LLVMGetEnumAttributeKindForName(name, strlen(name)), value);
+}
+
+static void add_attribute(LLVMValueRef target, LLVMAttributeIndex index, LLVMAttributeRef attribute) {
+	if (LLVMIsAFunction(target) != NULL) {
+		LLVMAddAttributeAtIndex(target, index, attribute);
+	} else {
+		LLVMAddCallSiteAttribute(target, index, attribute);
+	}
+}
+
+static void add_abi_value_attributes(State *state, LLVMValueRef target, Abi_Value *value, bool c_abi) {
+	unsigned int index = value->index + 1;
+	switch (value->kind) {
+		case ABI_DIRECT: {
+			if (value->extension != NULL) add_attribute(target, index, create_attribute(state, value->extension, 0));
+			if (value->noalias) add_attribute(target, index, create_attribute(state, "noalias", 0));
+			if (value->pointee_size > 0) add_attribute(target, index, create_attribute(state, "dereferenceable_or_null", value->pointee_size));
+			break;
+		}
+		case ABI_COERCE: {
+			if (!value->noalias) break;
+			for (unsigned int i = 0; i < value->part_count; i++) {
+				if (LLVMGetTypeKind(value->parts[i]) == LLVMPointerTypeKind) add_attribute(target, index + i, create_attribute(state, "noalias", 0));
+			}
+			break;
+		}
+		case ABI_INDIRECT: {
+			if (c_abi) {
+				unsigned int kind = LLVMGetEnumAttributeKindForName("byval", 5);
+				add_attribute(target, index, LLVMCreateTypeAttribute(state->llvm_context, kind, value->type));
+				add_attribute(target, index, create_attribute(state, "align", 8));
+			} else {
+				// The caller always passes a private copy, so the callee owns the storage outright
+				add_attribute(target, index, create_attribute(state, "noalias", 0));
+				add_attribute(target, index, create_attribute(state, "nonnull", 0));
+				add_attribute(target, index, create_attribute(state, "noundef", 0));
+				add_attribute(target, index, create_attribute(state, "dereferenceable", LLVMABISizeOfType(state->llvm_data->target_data, value->type)));
+			}
+			break;
+		}
+	}
+}
+
+static void add_abi_attributes(State *state, LLVMValueRef target, Function_Abi *abi) {
+	add_attribute(target, LLVMAttributeFunctionIndex, create_attribute(state, "nounwind", 0));
+
+	if (abi->returns) {
+		Abi_Value *return_ = &abi->return_;
+		if (return_->kind == ABI_DIRECT) {
+			if (return_->extension != NULL) add_attribute(target, LLVMAttributeReturnIndex, create_attribute(state, return_->extension, 0));
+			if (return_->pointee_size > 0) add_attribute(target, LLVMAttributeReturnIndex, create_attribute(state, "dereferenceable_or_null", return_->pointee_size));
+		} else if (return_->kind == ABI_INDIRECT) {
+			unsigned int kind = LLVMGetEnumAttributeKindForName("sret", 4);
+			add_attribute(target, 1, LLVMCreateTypeAttribute(state->llvm_context, kind, return_->type));
+			add_attribute(target, 1, create_attribute(state, "noalias", 0));
+		}
+	}
+
+	for (long int i = 0; i < arrlen(abi->arguments); i++) {
+		add_abi_value_attributes(state, target, &abi->arguments[i], abi->c_abi);
+	}
+
+	// The context is always the caller's live context and is never written through, see get_context_var
+	if (!abi->c_abi) {
+		unsigned int context_index = LLVMCountParamTypes(abi->llvm_type);
+		add_attribute(target, context_index, create_attribute(state, "nonnull", 0));
+		add_attribute(target, context_index, create_attribute(state, "noundef", 0));
+		add_attribute(target, context_index, create_attribute(state, "readonly", 0));
+		add_attribute(target, context_index, create_attribute(state, "nocapture", 0));
+		add_attribute(target, context_index, create_attribute(state, "dereferenceable", LLVMABISizeOfType(state->llvm_data->target_data, create_llvm_type(state->context.context_type.value, state))));
+	}
+}
+
+// Coerced parts can be moved with extractvalue and insertvalue when they are exactly the fields of the value
+static bool parts_match_fields(Abi_Value *value) {
+	if (LLVMGetTypeKind(value->type) != LLVMStructTypeKind) return false;
+	if (LLVMCountStructElementTypes(value->type) != value->part_count) return false;
+	for (unsigned int i = 0; i < value->part_count; i++) {
+		if (LLVMStructGetTypeAtIndex(value->type, i) != value->parts[i]) return false;
+	}
+	return true;
+}
+
+static LLVMValueRef build_part_pointer(State *state, LLVMValueRef storage, unsigned int part) {
+	LLVMValueRef offset = LLVMConstInt(LLVMInt64TypeInContext(state->llvm_context), part * 8, false);
+	return LLVMBuildGEP2(state->llvm_builder, LLVMInt8TypeInContext(state->llvm_context), storage, &offset, 1, "");
+}
+
+static void lower_abi_value(State *state, Abi_Value *value, LLVMValueRef llvm_value, LLVMValueRef **parameters) {
+	switch (value->kind) {
+		case ABI_DIRECT: {
+			arrpush(*parameters, llvm_value);
+			break;
+		}
+		case ABI_COERCE: {
+			if (parts_match_fields(value)) {
+				for (unsigned int i = 0; i < value->part_count; i++) {
+					arrpush(*parameters, LLVMBuildExtractValue(state->llvm_builder, llvm_value, i, ""));
+				}
+			} else {
+				LLVMValueRef storage = build_alloca(state, value->type);
+				LLVMBuildStore(state->llvm_builder, llvm_value, storage);
+				for (unsigned int i = 0; i < value->part_count; i++) {
+					arrpush(*parameters, LLVMBuildLoad2(state->llvm_builder, value->parts[i], build_part_pointer(state, storage, i), ""));
+				}
+			}
+			break;
+		}
+		case ABI_INDIRECT: {
+			LLVMValueRef storage = build_alloca(state, value->type);
+			LLVMBuildStore(state->llvm_builder, llvm_value, storage);
+			arrpush(*parameters, storage);
+			break;
+		}
+	}
+}
+
+// Storage for an argument received as the parameters of the current function
+static LLVMValueRef store_abi_parameters(State *state, Abi_Value *value) {
+	LLVMValueRef function = state->current_function;
+	switch (value->kind) {
+		case ABI_DIRECT: {
+			LLVMValueRef storage = build_alloca(state, value->type);
+			LLVMBuildStore(state->llvm_builder, LLVMGetParam(function, value->index), storage);
+			return storage;
+		}
+		case ABI_COERCE: {
+			LLVMValueRef storage = build_alloca(state, value->type);
+			if (parts_match_fields(value)) {
+				LLVMValueRef llvm_value = LLVMGetUndef(value->type);
+				for (unsigned int i = 0; i < value->part_count; i++) {
+					llvm_value = LLVMBuildInsertValue(state->llvm_builder, llvm_value, LLVMGetParam(function, value->index + i), i, "");
+				}
+				LLVMBuildStore(state->llvm_builder, llvm_value, storage);
+			} else {
+				for (unsigned int i = 0; i < value->part_count; i++) {
+					LLVMBuildStore(state->llvm_builder, LLVMGetParam(function, value->index + i), build_part_pointer(state, storage, i));
+				}
+			}
+			return storage;
+		}
+		case ABI_INDIRECT: {
+			return LLVMGetParam(function, value->index);
+		}
+	}
+
+	assert(false);
+	return NULL;
+}
+
+static LLVMValueRef raise_abi_return(State *state, Abi_Value *value, LLVMValueRef call, LLVMValueRef return_pointer) {
+	switch (value->kind) {
+		case ABI_DIRECT: {
+			return call;
+		}
+		case ABI_COERCE: {
+			if (value->part_count > 1 && parts_match_fields(value)) {
+				LLVMValueRef llvm_value = LLVMGetUndef(value->type);
+				for (unsigned int i = 0; i < value->part_count; i++) {
+					llvm_value = LLVMBuildInsertValue(state->llvm_builder, llvm_value, LLVMBuildExtractValue(state->llvm_builder, call, i, ""), i, "");
+				}
+				return llvm_value;
+			}
+
+			LLVMValueRef storage = build_alloca(state, value->type);
+			if (value->part_count == 1) {
+				LLVMBuildStore(state->llvm_builder, call, storage);
+			} else {
+				for (unsigned int i = 0; i < value->part_count; i++) {
+					LLVMBuildStore(state->llvm_builder, LLVMBuildExtractValue(state->llvm_builder, call, i, ""), build_part_pointer(state, storage, i));
+				}
+			}
+			return LLVMBuildLoad2(state->llvm_builder, value->type, storage, "");
+		}
+		case ABI_INDIRECT: {
+			return LLVMBuildLoad2(state->llvm_builder, value->type, return_pointer, "");
+		}
+	}
+
+	assert(false);
+	return NULL;
+}
+
+static void build_abi_return(State *state, LLVMValueRef llvm_value) {
+	Function_Abi *abi = state->function_abi;
+	if (!abi->returns) {
+		LLVMBuildRetVoid(state->llvm_builder);
+		return;
+	}
 
-		Typed_Value typed_value = data->define.typed_value;
-		if (typed_value.value.value == NULL) {
-			return;
+	Abi_Value *value = &abi->return_;
+	switch (value->kind) {
+		case ABI_DIRECT: {
+			LLVMBuildRet(state->llvm_builder, llvm_value);
+			break;
+		}
+		case ABI_COERCE: {
+			LLVMValueRef storage = build_alloca(state, value->type);
+			LLVMBuildStore(state->llvm_builder, llvm_value, storage);
+			if (value->part_count == 1) {
+				LLVMBuildRet(state->llvm_builder, LLVMBuildLoad2(state->llvm_builder, value->parts[0], storage, ""));
+			} else {
+				LLVMTypeRef return_type = LLVMGetReturnType(abi->llvm_type);
+				LLVMValueRef result = LLVMGetUndef(return_type);
+				for (unsigned int i = 0; i < value->part_count; i++) {
+					result = LLVMBuildInsertValue(state->llvm_builder, result, LLVMBuildLoad2(state->llvm_builder, value->parts[i], build_part_pointer(state, storage, i), ""), i, "");
+				}
+				LLVMBuildRet(state->llvm_builder, result);
+			}
+			break;
 		}
+		case ABI_INDIRECT: {
+			LLVMBuildStore(state->llvm_builder, llvm_value, LLVMGetParam(state->current_function, 0));
+			LLVMBuildRetVoid(state->llvm_builder);
+			break;
+		}
+	}
+}
 
-		LLVMValueRef llvm_value = generate_value(typed_value.value.value, typed_value.type.value, state);
-		state->main_function = llvm_value;
-		state->main_takes_arguments = arrlen(typed_value.value.value->function.type->function_type.arguments) > 0;
+// C default argument promotions
+static LLVMValueRef promote_variadic_argument(State *state, LLVMValueRef llvm_value, Value_Data *type) {
+	LLVMTypeRef int_type = LLVMInt32TypeInContext(state->llvm_context);
+	switch (type->tag) {
+		case INTEGER_TYPE_VALUE:
+			if (type->integer_type.size >= 32) return llvm_value;
+			if (type->integer_type.signed_) return LLVMBuildSExt(state->llvm_builder, llvm_value, int_type, "");
+			return LLVMBuildZExt(state->llvm_builder, llvm_value, int_type, "");
+		case BOOLEAN_TYPE_VALUE:
+		case BYTE_TYPE_VALUE:
+			return LLVMBuildZExt(state->llvm_builder, llvm_value, int_type, "");
+		case FLOAT_TYPE_VALUE:
+			if (type->float_type.size >= 64) return llvm_value;
+			return LLVMBuildFPExt(state->llvm_builder, llvm_value, LLVMDoubleTypeInContext(state->llvm_context), "");
+		default:
+			return llvm_value;
 	}
 }
 
-static LLVMValueRef generate_block(Node *node, State *state) {
-	assert(node->kind == BLOCK_NODE);
-	Block_Node block = node->block;
-	Block_Data block_data = get_data(&state->context, node)->block;
+// Tail calls must not point into the frame they replace, so the result and indirect arguments reuse the storage the caller itself received
+static LLVMValueRef build_abi_call(State *state, Function_Abi *abi, LLVMValueRef function_llvm_value, LLVMValueRef *llvm_values, Value_Data **types, bool tail) {
+	LLVMValueRef *parameters = NULL;
 
-	LLVMValueRef result = NULL;
-	for (long int i = 0; i < arrlen(block.statements); i++) {
-		if (block.statements[i]->kind == DEFER_NODE) continue;
+	LLVMValueRef return_pointer = NULL;
+	if (abi->returns && abi->return_.kind == ABI_INDIRECT) {
+		return_pointer = tail ? LLVMGetParam(state->current_function, 0) : build_alloca(state, abi->return_.type);
+		arrpush(parameters, return_pointer);
+	}
 
-		LLVMValueRef value = generate_node(block.statements[i], state);
-		if (block.has_result && i == arrlen(block.statements) - 1) {
-			result = value;
+	long int fixed_count = arrlen(abi->arguments);
+	for (long int i = 0; i < fixed_count; i++) {
+		Abi_Value *value = &abi->arguments[i];
+		if (tail && value->kind == ABI_INDIRECT) {
+			LLVMValueRef storage = LLVMGetParam(state->current_function, state->function_abi->arguments[i].index);
+			LLVMBuildStore(state->llvm_builder, llvm_values[i], storage);
+			arrpush(parameters, storage);
+		} else {
+			lower_abi_value(state, value, llvm_values[i], &parameters);
 		}
 	}
 
-	for (long int i = 0; i < arrlen(block_data.defers); i++) {
-		generate_node(block_data.defers[i], state);
+	if (!abi->c_abi) {
+		arrpush(parameters, get_context_var(state));
 	}
 
-	if (block.has_result) {
-		return result;
+	Function_Abi registers = *abi;
+	Abi_Value *variadic_values = NULL;
+	for (long int i = fixed_count; i < arrlen(llvm_values); i++) {
+		LLVMValueRef llvm_value = llvm_values[i];
+		if (abi->c_abi) llvm_value = promote_variadic_argument(state, llvm_value, types[i]);
+
+		Abi_Value value = classify_llvm_value(LLVMTypeOf(llvm_value), abi->c_abi, state);
+		if (abi->c_abi) assign_registers(&value, &registers);
+		value.index = arrlen(parameters);
+		lower_abi_value(state, &value, llvm_value, &parameters);
+		arrpush(variadic_values, value);
 	}
-	return NULL;
+
+	LLVMValueRef call = LLVMBuildCall2(state->llvm_builder, abi->llvm_type, function_llvm_value, parameters, arrlen(parameters), "");
+	add_abi_attributes(state, call, abi);
+	for (long int i = 0; i < arrlen(variadic_values); i++) {
+		add_abi_value_attributes(state, call, &variadic_values[i], abi->c_abi);
+	}
+
+	if (tail) {
+		LLVMSetTailCallKind(call, LLVMTailCallKindMustTail);
+		return call;
+	}
+
+	if (!abi->returns) return call;
+	return raise_abi_return(state, &abi->return_, call, return_pointer);
 }
 
-static LLVMValueRef generate_call_generic(LLVMValueRef function_llvm_value, Value_Data *function_type, Call_Argument_Value *arguments, State *state) {
+static LLVMValueRef generate_call_generic(LLVMValueRef function_llvm_value, Value_Data *function_type, Call_Argument_Value *arguments, bool c_abi, bool tail, State *state) {
 	assert(function_llvm_value != NULL);
 
-	LLVMValueRef *llvm_arguments = NULL;
+	Function_Argument_Value *function_arguments = function_type->function_type.arguments;
+
+	LLVMValueRef *llvm_values = NULL;
+	Value_Data **types = NULL;
 	for (long int i = 0; i < arrlen(arguments); i++) {
-		if (function_type->function_type.arguments[i].static_) continue;
+		if (i < arrlen(function_arguments) && function_arguments[i].static_) continue;
 		switch (arguments[i].kind) {
 			case CALL_ARGUMENT_NODE: {
-				arrpush(llvm_arguments, generate_node(arguments[i].node, state));
+				arrpush(llvm_values, generate_node(arguments[i].node, state));
+				arrpush(types, get_type(&state->context, arguments[i].node).value);
 				break;
 			}
 			case CALL_ARGUMENT_VALUE: {
-				arrpush(llvm_arguments, generate_value(arguments[i].value.value.value, arguments[i].value.type.value, state));
+				arrpush(llvm_values, generate_value(arguments[i].value.value.value, arguments[i].value.type.value, state));
+				arrpush(types, arguments[i].value.type.value);
 				break;
 			}
 			case CALL_ARGUMENT_NONE: {
@@ -306,25 +1276,32 @@ static LLVMValueRef generate_call_generic(LLVMValueRef function_llvm_value, Valu
 		}
 	}
 
-	arrpush(llvm_arguments, state->context_var);
-
-	return LLVMBuildCall2(state->llvm_builder, create_llvm_function_literal_type(function_type, state), function_llvm_value, llvm_arguments, arrlen(llvm_arguments), "");
+	Function_Abi abi = get_function_abi(function_type, c_abi, state);
+	return build_abi_call(state, &abi, function_llvm_value, llvm_values, types, tail);
 }
 
-static LLVMValueRef generate_call(Node *node, State *state) {
+static LLVMValueRef generate_call_node(Node *node, bool tail, State *state) {
 	assert(node->kind == CALL_NODE);
 	Call_Node call = node->call;
 
 	Call_Data call_data = get_data(&state->context, node)->call;
 	Value function_type = call_data.function_type;
 
-	if (call_data.function_value.value != NULL) {
-		return generate_call_generic(generate_value(call_data.function_value.value, call_data.function_type.value, state), function_type.value, call_data.arguments, state);
+	Value_Data *function_value = call_data.function_value.value;
+	if (function_value != NULL) {
+		if (function_value->tag == FUNCTION_VALUE && function_value->function.node->function.extern_.ptr != NULL) {
+			return generate_call_generic(generate_extern_function(function_value, state), function_type.value, call_data.arguments, true, tail, state);
+		}
+		return generate_call_generic(generate_value(function_value, call_data.function_type.value, state), function_type.value, call_data.arguments, false, tail, state);
 	} else {
-		return generate_call_generic(generate_node(call.function, state), function_type.value, call_data.arguments, state);
+		return generate_call_generic(generate_node(call.function, state), function_type.value, call_data.arguments, false, tail, state);
 	}
 }
 
+static LLVMValueRef generate_call(Node *node, State *state) {
+	return generate_call_node(node, false, state);
+}
+
 static bool is_type_signed(Value_Data *type) {
 	switch (type->tag) {
 		case INTEGER_TYPE_VALUE: {
@@ -341,29 +1318,49 @@ static bool is_type_float(Value_Data *type) {
 	return false;
 }
 
+// Fast-math flags only attach to instructions, operations on constants fold before they get here
+static LLVMValueRef build_fast_math(LLVMValueRef value, State *state) {
+	if (state->llvm_data->fast_math && LLVMIsAInstruction(value) != NULL) {
+		LLVMSetFastMathFlags(value, LLVMFastMathAll);
+	}
+
+	return value;
+}
+
+// Signed integer overflow is undefined while unsigned integers and bytes wrap, so only signed arithmetic carries nsw
+static bool is_overflow_undefined(Value_Data *type) {
+	return type->tag == INTEGER_TYPE_VALUE && type->integer_type.signed_;
+}
+
 static LLVMValueRef generate_op(Binary_Op_Node_Kind kind, Value type, LLVMValueRef left_value, LLVMValueRef right_value, State *state) {
 	switch (kind) {
 		case OP_ADD:
 			if (is_type_float(type.value)) {
-				return LLVMBuildFAdd(state->llvm_builder, left_value, right_value, "");
+				return build_fast_math(LLVMBuildFAdd(state->llvm_builder, left_value, right_value, ""), state);
+			} else if (is_overflow_undefined(type.value)) {
+				return LLVMBuildNSWAdd(state->llvm_builder, left_value, right_value, "");
 			} else {
 				return LLVMBuildAdd(state->llvm_builder, left_value, right_value, "");
 			}
 		case OP_SUBTRACT:
 			if (is_type_float(type.value)) {
-				return LLVMBuildFSub(state->llvm_builder, left_value, right_value, "");
+				return build_fast_math(LLVMBuildFSub(state->llvm_builder, left_value, right_value, ""), state);
+			} else if (is_overflow_undefined(type.value)) {
+				return LLVMBuildNSWSub(state->llvm_builder, left_value, right_value, "");
 			} else {
 				return LLVMBuildSub(state->llvm_builder, left_value, right_value, "");
 			}
 		case OP_MULTIPLY:
 			if (is_type_float(type.value)) {
-				return LLVMBuildFMul(state->llvm_builder, left_value, right_value, "");
+				return build_fast_math(LLVMBuildFMul(state->llvm_builder, left_value, right_value, ""), state);
+			} else if (is_overflow_undefined(type.value)) {
+				return LLVMBuildNSWMul(state->llvm_builder, left_value, right_value, "");
 			} else {
 				return LLVMBuildMul(state->llvm_builder, left_value, right_value, "");
 			}
 		case OP_DIVIDE:
 			if (is_type_float(type.value)) {
-				return LLVMBuildFDiv(state->llvm_builder, left_value, right_value, "");
+				return build_fast_math(LLVMBuildFDiv(state->llvm_builder, left_value, right_value, ""), state);
 			} else {
 				if (is_type_signed(type.value)) {
 					return LLVMBuildSDiv(state->llvm_builder, left_value, right_value, "");
@@ -384,7 +1381,7 @@ static LLVMValueRef generate_identifier(Node *node, State *state) {
 	switch (identifier_data->identifier.kind) {
 		case IDENTIFIER_VARIABLE: {
 			Node *variable = identifier_data->identifier.variable;
-			LLVMValueRef variable_llvm_value = hmget(state->variables, variable);
+			LLVMValueRef variable_llvm_value = get_slot(state, get_data(&state->context, variable))->variable;
 			if (identifier.assign_value != NULL) {
 				switch (identifier.assign_kind) {
 					case ASSIGN_STANDARD:
@@ -441,17 +1438,19 @@ static LLVMValueRef generate_identifier(Node *node, State *state) {
 			Node_Data *node_data = get_data(&state->context, node);
 			size_t index = identifier_data->identifier.binding.index;
 			if (node->kind == FOR_NODE) {
-				LLVMValueRef binding_llvm_value = hmget(state->fors, node_data).bindings[index];
+				LLVMValueRef binding_llvm_value = get_slot(state, node_data)->for_.bindings[index];
 				if (identifier_data->identifier.want_pointer || get_type(&state->context, node->for_.items[index]).value->tag == RANGE_TYPE_VALUE) {
 					return binding_llvm_value;
 				} else {
-					return LLVMBuildLoad2(state->llvm_builder, create_llvm_type(identifier_data->identifier.type.value, state), binding_llvm_value, "");
+					LLVMValueRef load = LLVMBuildLoad2(state->llvm_builder, create_llvm_type(identifier_data->identifier.type.value, state), binding_llvm_value, "");
+					annotate_tbaa(state, load, identifier_data->identifier.type.value);
+					return load;
 				}
 			} else if (node->kind == IF_NODE) {
-				LLVMValueRef binding_llvm_value = hmget(state->ifs, node_data).binding;
+				LLVMValueRef binding_llvm_value = get_slot(state, node_data)->if_.binding;
 				return binding_llvm_value;
 			} else if (node->kind == CATCH_NODE) {
-				LLVMValueRef binding_llvm_value = hmget(state->catchs, node_data).binding;
+				LLVMValueRef binding_llvm_value = get_slot(state, node_data)->catch.binding;
 				return binding_llvm_value;
 			} else {
 				assert(false);
@@ -490,15 +1489,9 @@ static LLVMValueRef generate_string(Node *node, State *state) {
 	LLVMValueRef pointer_llvm_value = LLVMBuildPointerCast(state->llvm_builder, global, LLVMPointerType(LLVMInt8TypeInContext(state->llvm_context), 0), "");
 
 	if (string_data.type.value->tag == STRING_TYPE_VALUE) {
-		LLVMValueRef string_value = LLVMBuildAlloca(state->llvm_builder, create_llvm_type(string_data.type.value, state), "");
-
-		LLVMValueRef length_pointer = LLVMBuildStructGEP2(state->llvm_builder, create_llvm_type(string_data.type.value, state), string_value, 0, "");
-		LLVMBuildStore(state->llvm_builder, LLVMConstInt(LLVMInt64TypeInContext(state->llvm_context), string_data.value.len, false), length_pointer);
-
-		LLVMValueRef pointer_pointer = LLVMBuildStructGEP2(state->llvm_builder, create_llvm_type(string_data.type.value, state), string_value, 1, "");
-		LLVMBuildStore(state->llvm_builder, pointer_llvm_value, pointer_pointer);
-
-		return LLVMBuildLoad2(state->llvm_builder, create_llvm_type(string_data.type.value, state), string_value, "");
+		LLVMValueRef string_value = LLVMGetUndef(create_llvm_type(string_data.type.value, state));
+		string_value = LLVMBuildInsertValue(state->llvm_builder, string_value, LLVMConstInt(LLVMInt64TypeInContext(state->llvm_context), string_data.value.len, false), 0, "");
+		return LLVMBuildInsertValue(state->llvm_builder, string_value, pointer_llvm_value, 1, "");
 	} else {
 		return pointer_llvm_value;
 	}
@@ -530,17 +1523,8 @@ static LLVMValueRef generate_null(Node *node, State *state) {
 			return LLVMConstNull(create_llvm_type(type, state));
 		case BYTE_TYPE_VALUE:
 			return LLVMConstInt(LLVMInt8TypeInContext(state->llvm_context), 0, false);
-		case OPTIONAL_TYPE_VALUE: {
-			if (type->optional_type.inner.value->tag == POINTER_TYPE_VALUE) {
-				return LLVMConstNull(create_llvm_type(type, state));
-			} else {
-				LLVMTypeRef optional_llvm_type = create_llvm_type(type, state);
-				LLVMValueRef value_ptr = LLVMBuildAlloca(state->llvm_builder, optional_llvm_type, "");
-				LLVMValueRef present_ptr = LLVMBuildStructGEP2(state->llvm_builder, optional_llvm_type, value_ptr, 0, "");
-				LLVMBuildStore(state->llvm_builder, LLVMConstInt(LLVMInt1TypeInContext(state->llvm_context), 0, false), present_ptr);
-				return LLVMBuildLoad2(state->llvm_builder, optional_llvm_type, value_ptr, "");
-			}
-		}
+		case OPTIONAL_TYPE_VALUE:
+			return build_variant(type, 0, NULL, state);
 		default:
 			assert(false);
 			return NULL;
@@ -562,49 +1546,33 @@ static LLVMValueRef generate_structure(Node *node, State *state) {
 
 	switch (type->tag) {
 		case STRUCT_TYPE_VALUE: {
-			LLVMValueRef struct_value = LLVMBuildAlloca(state->llvm_builder, create_llvm_type(type, state), "");
+			LLVMValueRef struct_value = LLVMGetUndef(create_llvm_type(type, state));
 			for (long int i = 0; i < arrlen(type->struct_type.members); i++) {
-				LLVMValueRef item_pointer = LLVMBuildStructGEP2(state->llvm_builder, create_llvm_type(type, state), struct_value, i, "");
-				LLVMBuildStore(state->llvm_builder, generate_node(structure_data.arguments[i], state), item_pointer);
+				struct_value = LLVMBuildInsertValue(state->llvm_builder, struct_value, generate_node(structure_data.arguments[i], state), i, "");
 			}
 
-			return LLVMBuildLoad2(state->llvm_builder, create_llvm_type(type, state), struct_value, "");
+			return struct_value;
 		}
 		case TUPLE_TYPE_VALUE: {
-			LLVMValueRef struct_value = LLVMBuildAlloca(state->llvm_builder, create_llvm_type(type, state), "");
+			LLVMValueRef struct_value = LLVMGetUndef(create_llvm_type(type, state));
 			for (long int i = 0; i < arrlen(type->tuple_type.members); i++) {
-				LLVMValueRef item_pointer = LLVMBuildStructGEP2(state->llvm_builder, create_llvm_type(type, state), struct_value, i, "");
-				LLVMValueRef v = generate_node(structure_data.arguments[i], state);
-				LLVMBuildStore(state->llvm_builder, v, item_pointer);
+				struct_value = LLVMBuildInsertValue(state->llvm_builder, struct_value, generate_node(structure_data.arguments[i], state), i, "");
 			}
 
-			return LLVMBuildLoad2(state->llvm_builder, create_llvm_type(type, state), struct_value, "");
+			return struct_value;
 		}
 		case ARRAY_TYPE_VALUE: {
-			LLVMValueRef array_value = LLVMBuildAlloca(state->llvm_builder, create_llvm_type(type, state), "");
+			LLVMValueRef array_value = LLVMGetUndef(create_llvm_type(type, state));
 			for (long int i = 0; i < type->array_type.size.value->integer.value; i++) {
-				LLVMValueRef indices[2] = {
-					LLVMConstInt(LLVMInt64TypeInContext(state->llvm_context), 0, false),
-					LLVMConstInt(LLVMInt64TypeInContext(state->llvm_context), i, false)
-				};
-
-				LLVMValueRef item_pointer = LLVMBuildGEP2(state->llvm_builder, create_llvm_type(type, state), array_value, indices, 2, "");
-				LLVMBuildStore(state->llvm_builder, generate_node(structure_data.arguments[i], state), item_pointer);
+				array_value = LLVMBuildInsertValue(state->llvm_builder, array_value, generate_node(structure_data.arguments[i], state), i, "");
 			}
 
-			return LLVMBuildLoad2(state->llvm_builder, create_llvm_type(type, state), array_value, "");
+			return array_value;
 		}
 		case TAGGED_UNION_TYPE_VALUE: {
-			LLVMValueRef tagged_union_value = LLVMBuildAlloca(state->llvm_builder, create_llvm_type(type, state), "");
 			for (long int i = 0; i < arrlen(type->tagged_union_type.items); i++) {
 				if (structure_data.arguments[i] != NULL) {
-					LLVMValueRef tag_pointer = LLVMBuildStructGEP2(state->llvm_builder, create_llvm_type(type, state), tagged_union_value, 0, "");
-					LLVMBuildStore(state->llvm_builder, LLVMConstInt(LLVMInt64TypeInContext(state->llvm_context), i, false), tag_pointer);
-					LLVMValueRef data_pointer = LLVMBuildStructGEP2(state->llvm_builder, create_llvm_type(type, state), tagged_union_value, 1, "");
-					data_pointer = LLVMBuildBitCast(state->llvm_builder, data_pointer, LLVMPointerType(create_llvm_type(type->tagged_union_type.items[i].type.value, state), 0), "");
-					LLVMBuildStore(state->llvm_builder, generate_node(node, state), data_pointer);
-
-					return LLVMBuildLoad2(state->llvm_builder, create_llvm_type(type, state), tagged_union_value, "");
+					return build_variant(type, i, generate_node(structure_data.arguments[i], state), state);
 				}
 			}
 
@@ -612,7 +1580,7 @@ static LLVMValueRef generate_structure(Node *node, State *state) {
 			return NULL;
 		}
 		case UNION_TYPE_VALUE: {
-			LLVMValueRef union_value = LLVMBuildAlloca(state->llvm_builder, create_llvm_type(type, state), "");
+			LLVMValueRef union_value = build_alloca(state, create_llvm_type(type, state));
 			for (long int i = 0; i < arrlen(type->tagged_union_type.items); i++) {
 				if (structure_data.arguments[i] != NULL) {
 					LLVMValueRef element_pointer = LLVMBuildBitCast(state->llvm_builder, union_value, LLVMPointerType(create_llvm_type(type->tagged_union_type.items[i].type.value, state), 0), "");
@@ -673,10 +1641,12 @@ static LLVMValueRef generate_dereference(Node *node, State *state) {
 
 	Dereference_Data dereference_data = get_data(&state->context, node)->dereference;
 	if (dereference.assign_value != NULL) {
-		LLVMBuildStore(state->llvm_builder, generate_node(dereference.assign_value, state), pointer_llvm_value);
+		annotate_tbaa(state, LLVMBuildStore(state->llvm_builder, generate_node(dereference.assign_value, state), pointer_llvm_value), dereference_data.type.value);
 		return NULL;
 	} else {
-		return LLVMBuildLoad2(state->llvm_builder, create_llvm_type(dereference_data.type.value, state), pointer_llvm_value, "");
+		LLVMValueRef load = LLVMBuildLoad2(state->llvm_builder, create_llvm_type(dereference_data.type.value, state), pointer_llvm_value, "");
+		annotate_tbaa(state, load, dereference_data.type.value);
+		return load;
 	}
 }
 
@@ -686,25 +1656,14 @@ static LLVMValueRef generate_deoptional(Node *node, State *state) {
 	LLVMValueRef optional_llvm_value = generate_node(deoptional.node, state);
 
 	Deoptional_Data deoptional_data = get_data(&state->context, node)->deoptional;
-	LLVMTypeRef optional_llvm_type = create_llvm_type(create_optional_type(deoptional_data.type).value, state);
+	Value_Data *optional_type = create_optional_type(deoptional_data.type).value;
 
 	if (deoptional.assign_value != NULL) {
-		if (deoptional_data.type.value->tag == POINTER_TYPE_VALUE) {
-			LLVMBuildStore(state->llvm_builder, generate_node(deoptional.assign_value, state), optional_llvm_value);
-		} else {
-			LLVMValueRef present_ptr = LLVMBuildStructGEP2(state->llvm_builder, optional_llvm_type, optional_llvm_value, 0, "");
-			LLVMValueRef value_ptr = LLVMBuildStructGEP2(state->llvm_builder, optional_llvm_type, optional_llvm_value, 1, "");
-			LLVMBuildStore(state->llvm_builder, LLVMConstInt(LLVMInt1TypeInContext(state->llvm_context), 1, false), present_ptr);
-			LLVMBuildStore(state->llvm_builder, generate_node(deoptional.assign_value, state), value_ptr);
-		}
+		LLVMBuildStore(state->llvm_builder, build_variant(optional_type, 1, generate_node(deoptional.assign_value, state), state), optional_llvm_value);
 		return NULL;
 	} else {
-		if (deoptional_data.type.value->tag == POINTER_TYPE_VALUE) {
-			return LLVMBuildLoad2(state->llvm_builder, create_llvm_type(deoptional_data.type.value, state), optional_llvm_value, "");
-		} else {
-			LLVMValueRef value_ptr = LLVMBuildStructGEP2(state->llvm_builder, optional_llvm_type, optional_llvm_value, 1, "");
-			return LLVMBuildLoad2(state->llvm_builder, create_llvm_type(deoptional_data.type.value, state), value_ptr, "");
-		}
+		LLVMValueRef optional_value = LLVMBuildLoad2(state->llvm_builder, create_llvm_type(optional_type, state), optional_llvm_value, "");
+		return build_payload(optional_type, optional_value, 1, state);
 	}
 }
 
@@ -714,46 +1673,12 @@ static LLVMValueRef generate_is(Node *node, State *state) {
 	Is_Data is_data = get_data(&state->context, node)->is;
 
 	LLVMValueRef value = generate_node(is.node, state);
-	LLVMValueRef value_tag = LLVMBuildExtractValue(state->llvm_builder, value, 0, "");
-
-	LLVMValueRef value_data = LLVMBuildExtractValue(state->llvm_builder, value, 1, "");
-	LLVMValueRef value_temp_storage = LLVMBuildAlloca(state->llvm_builder, LLVMTypeOf(value_data), "");
-	LLVMBuildStore(state->llvm_builder, value_data, value_temp_storage);
-
-	value_temp_storage = LLVMBuildBitCast(state->llvm_builder, value_temp_storage, create_llvm_type(create_pointer_type(is_data.type.value->optional_type.inner).value, state), "bitcast");
-
-	value_data = LLVMBuildLoad2(state->llvm_builder, create_llvm_type(is_data.type.value->optional_type.inner.value, state), value_temp_storage, "");
-	LLVMValueRef check_value = generate_value(is_data.value.value, is_data.type.value, state);
-
-	LLVMTypeRef optional_llvm_type = create_llvm_type(is_data.type.value, state);
-	if (is_data.type.value->optional_type.inner.value->tag == POINTER_TYPE_VALUE) {
-		LLVMValueRef optional_ptr = LLVMBuildAlloca(state->llvm_builder, optional_llvm_type, "");
-
-		LLVMBasicBlockRef present_block = LLVMAppendBasicBlockInContext(state->llvm_context, state->current_function, "");
-		LLVMBasicBlockRef empty_block = LLVMAppendBasicBlockInContext(state->llvm_context, state->current_function, "");
-		LLVMBasicBlockRef done_block = LLVMAppendBasicBlockInContext(state->llvm_context, state->current_function, "");
-
-		LLVMValueRef check = LLVMBuildICmp(state->llvm_builder, LLVMIntEQ, value_tag, check_value, "");
-		LLVMBuildCondBr(state->llvm_builder, check, present_block, empty_block);
-
-		LLVMPositionBuilderAtEnd(state->llvm_builder, present_block);
-		LLVMBuildStore(state->llvm_builder, value_data, optional_ptr);
-		LLVMBuildBr(state->llvm_builder, done_block);
-
-		LLVMPositionBuilderAtEnd(state->llvm_builder, empty_block);
-		LLVMBuildStore(state->llvm_builder, LLVMConstNull(optional_llvm_type), optional_ptr);
-		LLVMBuildBr(state->llvm_builder, done_block);
+	Value_Data *tagged_union_type = get_type(&state->context, is.node).value;
+	size_t variant = is_data.value.value->enum_.value;
 
-		LLVMPositionBuilderAtEnd(state->llvm_builder, done_block);
-		return LLVMBuildLoad2(state->llvm_builder, optional_llvm_type, optional_ptr, "");
-	} else {
-		LLVMValueRef optional_ptr = LLVMBuildAlloca(state->llvm_builder, optional_llvm_type, "");
-		LLVMValueRef optional_present_ptr = LLVMBuildStructGEP2(state->llvm_builder, optional_llvm_type, optional_ptr, 0, "");
-		LLVMValueRef optional_data_ptr = LLVMBuildStructGEP2(state->llvm_builder, optional_llvm_type, optional_ptr, 1, "");
-		LLVMBuildStore(state->llvm_builder, LLVMBuildICmp(state->llvm_builder, LLVMIntEQ, value_tag, check_value, ""), optional_present_ptr);
-		LLVMBuildStore(state->llvm_builder, value_data, optional_data_ptr);
-		return LLVMBuildLoad2(state->llvm_builder, optional_llvm_type, optional_ptr, "");
-	}
+	LLVMValueRef check = build_tag_check(tagged_union_type, value, variant, state);
+	LLVMValueRef present = build_variant(is_data.type.value, 1, build_payload(tagged_union_type, value, variant, state), state);
+	return LLVMBuildSelect(state->llvm_builder, check, present, build_variant(is_data.type.value, 0, NULL, state), "");
 }
 
 static LLVMValueRef generate_catch(Node *node, State *state) {
@@ -773,35 +1698,26 @@ static LLVMValueRef generate_catch(Node *node, State *state) {
 		result_value_type = create_llvm_type(catch_data.type.value->result_type.value.value, state);
 	}
 
-	LLVMTypeRef result_error_type = create_llvm_type(catch_data.type.value->result_type.error.value, state);
-	
 	LLVMValueRef result = NULL;
 	if (has_result_value) {
-		result = LLVMBuildAlloca(state->llvm_builder, result_value_type, "");
+		result = build_alloca(state, result_value_type);
 	}
 
 	LLVMValueRef value = generate_node(catch.value, state);
-	LLVMValueRef value_tag = LLVMBuildExtractValue(state->llvm_builder, value, 0, "");
-	LLVMValueRef cmp_result = LLVMBuildICmp(state->llvm_builder, LLVMIntEQ, value_tag, LLVMConstInt(LLVMInt64TypeInContext(state->llvm_context), 0, false), "");
-
-	LLVMValueRef value_data = LLVMBuildExtractValue(state->llvm_builder, value, 1, "");
-	LLVMValueRef value_data_ptr = LLVMBuildAlloca(state->llvm_builder, LLVMPointerType(LLVMTypeOf(value_data), 0), "");
-	LLVMBuildStore(state->llvm_builder, value_data, value_data_ptr);
-
-	LLVMBuildCondBr(state->llvm_builder, cmp_result, value_block, error_block);
+	LLVMBuildCondBr(state->llvm_builder, build_tag_check(catch_data.type.value, value, 0, state), value_block, error_block);
 
 	LLVMPositionBuilderAtEnd(state->llvm_builder, value_block);
 	if (has_result_value) {
-		LLVMBuildStore(state->llvm_builder, LLVMBuildLoad2(state->llvm_builder, result_value_type, LLVMBuildBitCast(state->llvm_builder, value_data_ptr, LLVMPointerType(result_value_type, 0), ""), ""), result);
+		LLVMBuildStore(state->llvm_builder, build_payload(catch_data.type.value, value, 0, state), result);
 	}
 	LLVMBuildBr(state->llvm_builder, end_block);
 
 	LLVMPositionBuilderAtEnd(state->llvm_builder, error_block);
 	if (catch.binding.ptr != NULL) {
 		Catch_Codegen_Data catch_codegen_data = {
-			.binding = LLVMBuildLoad2(state->llvm_builder, result_error_type, LLVMBuildBitCast(state->llvm_builder, value_data_ptr, LLVMPointerType(result_error_type, 0), ""), "")
+			.binding = build_payload(catch_data.type.value, value, 1, state)
 		};
-		hmput(state->catchs, data, catch_codegen_data);
+		get_slot(state, data)->catch = catch_codegen_data;
 	}
 
 	LLVMValueRef error_result = generate_node(catch.error, state);
@@ -820,6 +1736,82 @@ static LLVMValueRef generate_catch(Node *node, State *state) {
 	}
 }
 
+// Address of the storage behind an lvalue expression, or NULL without emitting anything when the value is a temporary
+static LLVMValueRef generate_address(Node *node, State *state) {
+	switch (node->kind) {
+		case IDENTIFIER_NODE: {
+			if (node->identifier.assign_value != NULL) return NULL;
+
+			Node_Data *identifier_data = get_data(&state->context, node);
+			switch (identifier_data->identifier.kind) {
+				case IDENTIFIER_VARIABLE:
+					return get_slot(state, get_data(&state->context, identifier_data->identifier.variable))->variable;
+				case IDENTIFIER_ARGUMENT:
+					return state->function_arguments[identifier_data->identifier.argument_index];
+				case IDENTIFIER_BINDING: {
+					Node *binding_node = identifier_data->identifier.binding.node;
+					size_t index = identifier_data->identifier.binding.index;
+					if (binding_node->kind == FOR_NODE && get_type(&state->context, binding_node->for_.items[index]).value->tag != RANGE_TYPE_VALUE) {
+						return get_slot(state, get_data(&state->context, binding_node))->for_.bindings[index];
+					}
+					return NULL;
+				}
+				default:
+					return NULL;
+			}
+		}
+		case DEREFERENCE_NODE: {
+			if (node->dereference.assign_value != NULL) return NULL;
+			return generate_node(node->dereference.node, state);
+		}
+		case STRUCTURE_ACCESS_NODE: {
+			Structure_Access_Node structure_access = node->structure_access;
+			if (structure_access.assign_value != NULL) return NULL;
+
+			Structure_Access_Data data = get_data(&state->context, node)->structure_access;
+			Value_Data *structure_type = data.structure_type.value;
+			// Union members are type punned, so they stay on the untyped path
+			if (structure_type->tag == MODULE_TYPE_VALUE || structure_type->tag == UNION_TYPE_VALUE) return NULL;
+
+			LLVMValueRef structure_pointer = NULL;
+			if (data.pointer_access) {
+				structure_pointer = generate_node(structure_access.parent, state);
+			} else {
+				structure_pointer = generate_address(structure_access.parent, state);
+				if (structure_pointer == NULL) return NULL;
+			}
+
+			return LLVMBuildStructGEP2(state->llvm_builder, create_llvm_type(structure_type, state), structure_pointer, data.index, "");
+		}
+		case ARRAY_ACCESS_NODE: {
+			Array_Access_Node array_access = node->array_access;
+			if (array_access.assign_value != NULL) return NULL;
+
+			Array_Access_Data array_access_data = get_data(&state->context, node)->array_access;
+			if (array_access_data.function.value.value != NULL) return NULL;
+
+			Value_Data *array_type = array_access_data.array_type.value;
+			if (array_type->tag != ARRAY_TYPE_VALUE) return NULL;
+
+			LLVMValueRef array_pointer = NULL;
+			if (array_access_data.pointer_access) {
+				array_pointer = generate_node(array_access.parent, state);
+			} else {
+				array_pointer = generate_address(array_access.parent, state);
+				if (array_pointer == NULL) return NULL;
+			}
+
+			LLVMValueRef indices[2] = {
+				LLVMConstInt(LLVMInt64TypeInContext(state->llvm_context), 0, false),
+				generate_node(array_access.index, state)
+			};
+			return LLVMBuildGEP2(state->llvm_builder, create_llvm_type(array_type, state), array_pointer, indices, 2, "");
+		}
+		default:
+			return NULL;
+	}
+}
+
 static LLVMValueRef generate_structure_access(Node *node, State *state) {
 	assert(node->kind == STRUCTURE_ACCESS_NODE);
 	Structure_Access_Node structure_access = node->structure_access;
@@ -831,46 +1823,16 @@ static LLVMValueRef generate_structure_access(Node *node, State *state) {
 		return generate_value(data.value.value, data.item_type.value, state);
 	}
 
-	unsigned int index = 0;
+	unsigned int index = data.index;
 	Value_Data *item_type = data.item_type.value;
-	switch (structure_type->tag) {
-		case STRUCT_TYPE_VALUE: {
-			for (long int i = 0; i < arrlen(structure_type->struct_type.members); i++) {
-				if (sv_eq(structure_access.name, structure_type->struct_type.node->struct_type.members[i].name)) {
-					index = i;
-					break;
-				}
-			}
-			break;
-		}
-		case TUPLE_TYPE_VALUE: {
-			char buffer[24];
-			memcpy(buffer, structure_access.name.ptr + 1, structure_access.name.len);
-			buffer[structure_access.name.len] = '\0';
-			index = strtoul(buffer, NULL, 10);
-			break;
-		}
-		case UNION_TYPE_VALUE: {
-			for (long int i = 0; i < arrlen(structure_type->union_type.items); i++) {
-				if (sv_eq(structure_access.name, structure_type->union_type.items[i].identifier)) {
-					index = i;
-					break;
-				}
-			}
-			break;
-		}
-		case ARRAY_VIEW_TYPE_VALUE: {
-			if (sv_eq_cstr(structure_access.name, "len")) {
-				index = 0;
-			} else if (sv_eq_cstr(structure_access.name, "data")) {
-				index = 1;
-			} else {
-				assert(false);
-			}
-			break;
+
+	if (!data.pointer_access && structure_access.assign_value == NULL) {
+		LLVMValueRef element_pointer = generate_address(node, state);
+		if (element_pointer != NULL) {
+			LLVMValueRef load = LLVMBuildLoad2(state->llvm_builder, create_llvm_type(item_type, state), element_pointer, "");
+			annotate_tbaa(state, load, item_type);
+			return load;
 		}
-		default:
-			assert(false);
 	}
 
 	LLVMValueRef structure_llvm_value = generate_node(structure_access.parent, state);
@@ -887,21 +1849,25 @@ static LLVMValueRef generate_structure_access(Node *node, State *state) {
 			assert(false);
 		}
 
+		Value_Data *access_type = structure_type->tag == UNION_TYPE_VALUE ? NULL : item_type;
 		if (structure_access.assign_value != NULL) {
-			LLVMBuildStore(state->llvm_builder, generate_node(structure_access.assign_value, state), element_pointer);
+			LLVMValueRef store = LLVMBuildStore(state->llvm_builder, generate_node(structure_access.assign_value, state), element_pointer);
+			if (access_type != NULL) annotate_tbaa(state, store, access_type);
 			return NULL;
 		} else {
 			if (data.want_pointer) {
 				return element_pointer;
 			} else  {
-				return LLVMBuildLoad2(state->llvm_builder, create_llvm_type(item_type, state), element_pointer, "");
+				LLVMValueRef load = LLVMBuildLoad2(state->llvm_builder, create_llvm_type(item_type, state), element_pointer, "");
+				if (access_type != NULL) annotate_tbaa(state, load, access_type);
+				return load;
 			}
 		}
 	} else {
 		if (structure_type->tag == STRUCT_TYPE_VALUE || structure_type->tag == TUPLE_TYPE_VALUE || structure_type->tag == ARRAY_VIEW_TYPE_VALUE) {
 			return LLVMBuildExtractValue(state->llvm_builder, structure_llvm_value, index, "");
 		} else if (structure_type->tag == UNION_TYPE_VALUE) {
-			LLVMValueRef temp = LLVMBuildAlloca(state->llvm_builder, LLVMTypeOf(structure_llvm_value), "");
+			LLVMValueRef temp = build_alloca(state, LLVMTypeOf(structure_llvm_value));
 			LLVMBuildStore(state->llvm_builder, structure_llvm_value, temp);
 
 			LLVMTypeRef item_type_llvm = create_llvm_type(data.item_type.value, state);
@@ -920,14 +1886,23 @@ static LLVMValueRef generate_array_access(Node *node, State *state) {
 
 	if (array_access_data.function.value.value != NULL) {
 		if (array_access.assign_value != NULL) {
-			return generate_call_generic(generate_value(array_access_data.function.value.value, array_access_data.function.type.value, state), array_access_data.function.type.value, array_access_data.arguments, state);
+			return generate_call_generic(generate_value(array_access_data.function.value.value, array_access_data.function.type.value, state), array_access_data.function.type.value, array_access_data.arguments, false, false, state);
 		} else {
-			return generate_call_generic(generate_value(array_access_data.function.value.value, array_access_data.function.type.value, state), array_access_data.function.type.value, array_access_data.arguments, state);
+			return generate_call_generic(generate_value(array_access_data.function.value.value, array_access_data.function.type.value, state), array_access_data.function.type.value, array_access_data.arguments, false, false, state);
 		}
 	}
 
 	Value_Data *array_type = array_access_data.array_type.value;
 
+	if (!array_access_data.pointer_access && array_access.assign_value == NULL) {
+		LLVMValueRef element_pointer = generate_address(node, state);
+		if (element_pointer != NULL) {
+			LLVMValueRef load = LLVMBuildLoad2(state->llvm_builder, create_llvm_type(array_access_data.item_type.value, state), element_pointer, "");
+			annotate_tbaa(state, load, array_access_data.item_type.value);
+			return load;
+		}
+	}
+
 	LLVMValueRef array_llvm_value = generate_node(array_access.parent, state);
 	LLVMValueRef element_pointer = NULL;
 
@@ -955,13 +1930,15 @@ static LLVMValueRef generate_array_access(Node *node, State *state) {
 		}
 
 		if (array_access.assign_value != NULL) {
-			LLVMBuildStore(state->llvm_builder, generate_node(array_access.assign_value, state), element_pointer);
+			annotate_tbaa(state, LLVMBuildStore(state->llvm_builder, generate_node(array_access.assign_value, state), element_pointer), array_access_data.item_type.value);
 			return NULL;
 		} else {
 			if (array_access_data.want_pointer) {
 				return element_pointer;
 			} else  {
-				return LLVMBuildLoad2(state->llvm_builder, create_llvm_type(array_access_data.item_type.value, state), element_pointer, "");
+				LLVMValueRef load = LLVMBuildLoad2(state->llvm_builder, create_llvm_type(array_access_data.item_type.value, state), element_pointer, "");
+				annotate_tbaa(state, load, array_access_data.item_type.value);
+				return load;
 			}
 		}
 	} else {
@@ -974,7 +1951,7 @@ static LLVMValueRef generate_array_access(Node *node, State *state) {
 			case ARRAY_TYPE_VALUE: {
 				LLVMTypeRef inner_type = create_llvm_type(array_type->array_type.inner.value, state);
 				LLVMTypeRef array_llvm_type = LLVMTypeOf(array_llvm_value);
-				LLVMValueRef allocated_llvm = LLVMBuildAlloca(state->llvm_builder, array_llvm_type, "");
+				LLVMValueRef allocated_llvm = build_alloca(state, array_llvm_type);
 				LLVMBuildStore(state->llvm_builder, array_llvm_value, allocated_llvm);
 				return LLVMBuildLoad2(state->llvm_builder, inner_type, LLVMBuildGEP2(state->llvm_builder, array_llvm_type, allocated_llvm, indices, 2, ""), "");
 			}
@@ -983,7 +1960,9 @@ static LLVMValueRef generate_array_access(Node *node, State *state) {
 				LLVMTypeRef actual_array_llvm_type = LLVMArrayType2(inner_type, 0);
 				LLVMValueRef elements_pointer = LLVMBuildExtractValue(state->llvm_builder, array_llvm_value, 1, "");
 				element_pointer = LLVMBuildGEP2(state->llvm_builder, actual_array_llvm_type, elements_pointer, indices, 2, "");
-				return LLVMBuildLoad2(state->llvm_builder, inner_type, element_pointer, "");
+				LLVMValueRef load = LLVMBuildLoad2(state->llvm_builder, inner_type, element_pointer, "");
+				annotate_tbaa(state, load, array_type->array_view_type.inner.value);
+				return load;
 			}
 			case STRING_TYPE_VALUE: {
 				LLVMTypeRef actual_array_llvm_type = LLVMArrayType2(LLVMInt8TypeInContext(state->llvm_context), 0);
@@ -1008,6 +1987,9 @@ static LLVMValueRef values_equal(Value_Data *type, LLVMValueRef value1, LLVMValu
 		case INTEGER_TYPE_VALUE: {
 			return LLVMBuildICmp(state->llvm_builder, LLVMIntEQ, value1, value2, "");
 		}
+		case FLOAT_TYPE_VALUE: {
+			return build_fast_math(LLVMBuildFCmp(state->llvm_builder, LLVMRealOEQ, value1, value2, ""), state);
+		}
 		case ENUM_TYPE_VALUE: {
 			return LLVMBuildICmp(state->llvm_builder, LLVMIntEQ, value1, value2, "");
 		}
@@ -1022,7 +2004,7 @@ static LLVMValueRef values_equal(Value_Data *type, LLVMValueRef value1, LLVMValu
 			LLVMBasicBlockRef loop_done_block = LLVMAppendBasicBlockInContext(state->llvm_context, state->current_function, "");
 			LLVMBasicBlockRef done_block = LLVMAppendBasicBlockInContext(state->llvm_context, state->current_function, "");
 
-			LLVMValueRef result_storage = LLVMBuildAlloca(state->llvm_builder, LLVMInt1TypeInContext(state->llvm_context), "");
+			LLVMValueRef result_storage = build_alloca(state, LLVMInt1TypeInContext(state->llvm_context));
 			LLVMBuildStore(state->llvm_builder, LLVMConstInt(LLVMInt1TypeInContext(state->llvm_context), 0, false), result_storage);
 
 			LLVMValueRef value1_len = LLVMBuildExtractValue(state->llvm_builder, value1, 0, "");
@@ -1033,7 +2015,7 @@ static LLVMValueRef values_equal(Value_Data *type, LLVMValueRef value1, LLVMValu
 			LLVMBuildCondBr(state->llvm_builder, lengths_equal, compare_block, done_block);
 			LLVMPositionBuilderAtEnd(state->llvm_builder, compare_block);
 
-			LLVMValueRef i = LLVMBuildAlloca(state->llvm_builder, LLVMInt64TypeInContext(state->llvm_context), "");
+			LLVMValueRef i = build_alloca(state, LLVMInt64TypeInContext(state->llvm_context));
 			LLVMBuildStore(state->llvm_builder, LLVMConstInt(LLVMInt64TypeInContext(state->llvm_context), 0, false), i);
 
 			LLVMBuildBr(state->llvm_builder, loop_block);
@@ -1052,7 +2034,7 @@ static LLVMValueRef values_equal(Value_Data *type, LLVMValueRef value1, LLVMValu
 			LLVMValueRef equal_values = values_equal(type->array_view_type.inner.value, value1_value, value2_value, state);
 			LLVMBuildCondBr(state->llvm_builder, equal_values, loop_increment_block, done_block);
 			LLVMPositionBuilderAtEnd(state->llvm_builder, loop_increment_block);
-			LLVMBuildStore(state->llvm_builder, LLVMBuildAdd(state->llvm_builder, LLVMBuildLoad2(state->llvm_builder, LLVMInt64TypeInContext(state->llvm_context), i, ""), LLVMConstInt(LLVMInt64TypeInContext(state->llvm_context), 1, false), ""), i);
+			LLVMBuildStore(state->llvm_builder, LLVMBuildNUWAdd(state->llvm_builder, LLVMBuildLoad2(state->llvm_builder, LLVMInt64TypeInContext(state->llvm_context), i, ""), LLVMConstInt(LLVMInt64TypeInContext(state->llvm_context), 1, false), ""), i);
 			LLVMBuildBr(state->llvm_builder, loop_block);
 
 			LLVMPositionBuilderAtEnd(state->llvm_builder, loop_done_block);
@@ -1077,7 +2059,7 @@ static LLVMValueRef generate_binary_op(Node *node, State *state) {
 		Call_Argument_Value *arguments = NULL;
 		arrpush(arguments, ((Call_Argument_Value) { .kind = CALL_ARGUMENT_NODE, .node = binary_operator.left }));
 		arrpush(arguments, ((Call_Argument_Value) { .kind = CALL_ARGUMENT_NODE, .node = binary_operator.right }));
-		return generate_call_generic(generate_value(binary_operator_data.function.value.value, binary_operator_data.function.type.value, state), binary_operator_data.function.type.value, arguments, state);
+		return generate_call_generic(generate_value(binary_operator_data.function.value.value, binary_operator_data.function.type.value, state), binary_operator_data.function.type.value, arguments, false, false, state);
 	}
 
 	LLVMValueRef left_value = generate_node(binary_operator.left, state);
@@ -1089,25 +2071,33 @@ static LLVMValueRef generate_binary_op(Node *node, State *state) {
 		case OP_NOT_EQUALS:
 			return LLVMBuildNot(state->llvm_builder, values_equal(binary_operator_data.type.value, left_value, right_value, state), "");
 		case OP_LESS:
-			if (is_type_signed(binary_operator_data.type.value)) {
+			if (is_type_float(binary_operator_data.type.value)) {
+				return build_fast_math(LLVMBuildFCmp(state->llvm_builder, LLVMRealOLT, left_value, right_value, ""), state);
+			} else if (is_type_signed(binary_operator_data.type.value)) {
 				return LLVMBuildICmp(state->llvm_builder, LLVMIntSLT, left_value, right_value, "");
 			} else {
 				return LLVMBuildICmp(state->llvm_builder, LLVMIntULT, left_value, right_value, "");
 			}
 		case OP_LESS_EQUALS:
-			if (is_type_signed(binary_operator_data.type.value)) {
+			if (is_type_float(binary_operator_data.type.value)) {
+				return build_fast_math(LLVMBuildFCmp(state->llvm_builder, LLVMRealOLE, left_value, right_value, ""), state);
+			} else if (is_type_signed(binary_operator_data.type.value)) {
 				return LLVMBuildICmp(state->llvm_builder, LLVMIntSLE, left_value, right_value, "");
 			} else {
 				return LLVMBuildICmp(state->llvm_builder, LLVMIntULE, left_value, right_value, "");
 			}
 		case OP_GREATER:
-			if (is_type_signed(binary_operator_data.type.value)) {
+			if (is_type_float(binary_operator_data.type.value)) {
+				return build_fast_math(LLVMBuildFCmp(state->llvm_builder, LLVMRealOGT, left_value, right_value, ""), state);
+			} else if (is_type_signed(binary_operator_data.type.value)) {
 				return LLVMBuildICmp(state->llvm_builder, LLVMIntSGT, left_value, right_value, "");
 			} else {
 				return LLVMBuildICmp(state->llvm_builder, LLVMIntUGT, left_value, right_value, "");
 			}
 		case OP_GREATER_EQUALS:
-			if (is_type_signed(binary_operator_data.type.value)) {
+			if (is_type_float(binary_operator_data.type.value)) {
+				return build_fast_math(LLVMBuildFCmp(state->llvm_builder, LLVMRealOGE, left_value, right_value, ""), state);
+			} else if (is_type_signed(binary_operator_data.type.value)) {
 				return LLVMBuildICmp(state->llvm_builder, LLVMIntSGE, left_value, right_value, "");
 			} else {
 				return LLVMBuildICmp(state->llvm_builder, LLVMIntUGE, left_value, right_value, "");
@@ -1119,7 +2109,7 @@ static LLVMValueRef generate_binary_op(Node *node, State *state) {
 			return generate_op(binary_operator.operator, binary_operator_data.type, left_value, right_value, state);
 		case OP_MODULUS:
 			if (is_type_float(binary_operator_data.type.value)) {
-				return LLVMBuildFRem(state->llvm_builder, left_value, right_value, "");
+				return build_fast_math(LLVMBuildFRem(state->llvm_builder, left_value, right_value, ""), state);
 			} else {
 				if (is_type_signed(binary_operator_data.type.value)) {
 					return LLVMBuildSRem(state->llvm_builder, left_value, right_value, "");
@@ -1127,6 +2117,18 @@ static LLVMValueRef generate_binary_op(Node *node, State *state) {
 					return LLVMBuildURem(state->llvm_builder, left_value, right_value, "");
 				}
 			}
+		case OP_BITWISE_AND:
+			return LLVMBuildAnd(state->llvm_builder, left_value, right_value, "");
+		case OP_BITWISE_XOR:
+			return LLVMBuildXor(state->llvm_builder, left_value, right_value, "");
+		case OP_SHIFT_LEFT:
+			return LLVMBuildShl(state->llvm_builder, left_value, right_value, "");
+		case OP_SHIFT_RIGHT:
+			if (is_type_signed(binary_operator_data.type.value)) {
+				return LLVMBuildAShr(state->llvm_builder, left_value, right_value, "");
+			} else {
+				return LLVMBuildLShr(state->llvm_builder, left_value, right_value, "");
+			}
 		case OP_AND:
 			return LLVMBuildAnd(state->llvm_builder, left_value, right_value, "");
 		case OP_OR:
@@ -1142,8 +2144,17 @@ static LLVMValueRef generate_return(Node *node, State *state) {
 	Return_Node return_ = node->return_;
 	Return_Data return_data = get_data(&state->context, node)->return_;
 
-	if (return_data.type.value != NULL) {
-		LLVMBuildRet(state->llvm_builder, generate_node(return_.value, state));
+	if (return_.tail) {
+		// Nothing may come between a musttail call and its return, so sret results are already in place
+		LLVMValueRef call = generate_call_node(return_.value, true, state);
+		Function_Abi *abi = state->function_abi;
+		if (abi->returns && abi->return_.kind == ABI_DIRECT) {
+			LLVMBuildRet(state->llvm_builder, call);
+		} else {
+			LLVMBuildRetVoid(state->llvm_builder);
+		}
+	} else if (return_data.type.value != NULL) {
+		build_abi_return(state, generate_node(return_.value, state));
 	} else {
 		LLVMBuildRetVoid(state->llvm_builder);
 	}
@@ -1158,14 +2169,14 @@ static LLVMValueRef generate_variable(Node *node, State *state) {
 		return NULL;
 	}
 
-	LLVMValueRef allocated_variable_llvm = LLVMBuildAlloca(state->llvm_builder, create_llvm_type(get_data(&state->context, node)->variable.type.value, state), "");
+	LLVMValueRef allocated_variable_llvm = build_alloca(state, create_llvm_type(get_data(&state->context, node)->variable.type.value, state));
 
 	if (variable.value != NULL) {
 		LLVMValueRef llvm_value = generate_node(variable.value, state);
 		LLVMBuildStore(state->llvm_builder, llvm_value, allocated_variable_llvm);
 	}
 
-	hmput(state->variables, node, allocated_variable_llvm);
+	get_slot(state, get_data(&state->context, node))->variable = allocated_variable_llvm;
 
 	return NULL;
 }
@@ -1175,7 +2186,7 @@ static LLVMValueRef generate_break(Node *node, State *state) {
 	Break_Node break_ = node->break_;
 	Break_Data break_data = get_data(&state->context, node)->break_;
 	Node_Data *while_data = get_data(&state->context, break_data.while_);
-	While_Codegen_Data while_codegen_data = hmget(state->whiles, while_data);
+	While_Codegen_Data while_codegen_data = get_slot(state, while_data)->while_;
 	if (break_.value != NULL) {
 		LLVMBuildStore(state->llvm_builder, generate_node(break_.value, state), while_codegen_data.value);
 	}
@@ -1205,36 +2216,19 @@ static LLVMValueRef generate_if(Node *node, State *state) {
 	} else {
 		LLVMValueRef value = NULL;
 		if (if_data.result_type.value != NULL) {
-			value = LLVMBuildAlloca(state->llvm_builder, create_llvm_type(if_data.result_type.value, state), "");
+			value = build_alloca(state, create_llvm_type(if_data.result_type.value, state));
 		}
 
 		LLVMValueRef condition = generate_node(if_.condition, state);
-		if (if_data.type.value->tag == OPTIONAL_TYPE_VALUE) {
-			LLVMValueRef optional_llvm_value = condition;
-			If_Codegen_Data if_codegen_data = {
-				.binding = if_data.type.value->optional_type.inner.value->tag == POINTER_TYPE_VALUE ? optional_llvm_value : LLVMBuildExtractValue(state->llvm_builder, optional_llvm_value, 1, "")
-			};
-			hmput(state->ifs, data, if_codegen_data);
-
-			if (if_data.type.value->optional_type.inner.value->tag == POINTER_TYPE_VALUE) {
-				condition = LLVMBuildICmp(state->llvm_builder, LLVMIntNE, optional_llvm_value, LLVMConstNull(LLVMTypeOf(optional_llvm_value)), "");
-			} else {
-				condition = LLVMBuildExtractValue(state->llvm_builder, optional_llvm_value, 0, "");
-			}
-		} else if (if_data.type.value->tag == RESULT_TYPE_VALUE) {
-			LLVMValueRef result_llvm_value = condition;
-
-			LLVMValueRef value_data = LLVMBuildExtractValue(state->llvm_builder, result_llvm_value, 1, "");
-			LLVMValueRef value_data_ptr = LLVMBuildAlloca(state->llvm_builder, LLVMPointerType(LLVMTypeOf(value_data), 0), "");
-			LLVMBuildStore(state->llvm_builder, value_data, value_data_ptr);
-
-			LLVMTypeRef result_value_type = create_llvm_type(if_data.type.value->result_type.value.value, state);
+		// Optionals bind their value when present and results when ok
+		if (if_data.type.value->tag == OPTIONAL_TYPE_VALUE || if_data.type.value->tag == RESULT_TYPE_VALUE) {
+			size_t variant = if_data.type.value->tag == OPTIONAL_TYPE_VALUE ? 1 : 0;
 			If_Codegen_Data if_codegen_data = {
-				.binding = LLVMBuildLoad2(state->llvm_builder, result_value_type, LLVMBuildBitCast(state->llvm_builder, value_data_ptr, LLVMPointerType(result_value_type, 0), ""), "")
+				.binding = build_payload(if_data.type.value, condition, variant, state)
 			};
-			hmput(state->ifs, data, if_codegen_data);
+			get_slot(state, data)->if_ = if_codegen_data;
 
-			condition = LLVMBuildICmp(state->llvm_builder, LLVMIntEQ, LLVMBuildExtractValue(state->llvm_builder, result_llvm_value, 0, ""), LLVMConstInt(LLVMInt64TypeInContext(state->llvm_context), 0, false), "");
+			condition = build_tag_check(if_data.type.value, condition, variant, state);
 		}
 
 		LLVMBasicBlockRef if_block = LLVMAppendBasicBlockInContext(state->llvm_context, state->current_function, "");
@@ -1286,10 +2280,14 @@ static LLVMValueRef generate_switch(Node *node, State *state) {
 
 	LLVMValueRef value = NULL;
 	if (switch_data.type.value != NULL) {
-		value = LLVMBuildAlloca(state->llvm_builder, create_llvm_type(switch_data.type.value, state), "");
+		value = build_alloca(state, create_llvm_type(switch_data.type.value, state));
 	}
 
 	LLVMValueRef switched_value = generate_node(switch_.condition, state);
+	Value_Data *switched_type = get_type(&state->context, switch_.condition).value;
+	if (switched_type->tag == TAGGED_UNION_TYPE_VALUE) {
+		switched_value = build_tag(switched_type, switched_value, state);
+	}
 
 	bool added_else_block = false;
 	LLVMBasicBlockRef else_block = LLVMAppendBasicBlockInContext(state->llvm_context, state->current_function, "");
@@ -1354,7 +2352,7 @@ static LLVMValueRef generate_while(Node *node, State *state) {
 
 		LLVMValueRef value = NULL;
 		if (while_data.type.value != NULL) {
-			value = LLVMBuildAlloca(state->llvm_builder, create_llvm_type(while_data.type.value, state), "");
+			value = build_alloca(state, create_llvm_type(while_data.type.value, state));
 		}
 
 		While_Codegen_Data while_codegen_data = {
@@ -1362,7 +2360,7 @@ static LLVMValueRef generate_while(Node *node, State *state) {
 			.value = value
 		};
 
-		hmput(state->whiles, data, while_codegen_data);
+		get_slot(state, data)->while_ = while_codegen_data;
 		LLVMBuildBr(state->llvm_builder, check_block);
 		LLVMPositionBuilderAtEnd(state->llvm_builder, check_block);
 		LLVMValueRef condition = generate_node(while_.condition, state);
@@ -1419,7 +2417,12 @@ static LLVMValueRef generate_for(Node *node, State *state) {
 				break;
 			}
 			case RANGE_TYPE_VALUE: {
-				len = LLVMBuildExtractValue(state->llvm_builder, items[i], 1, "");
+				// Ranges that end before they start are empty
+				LLVMValueRef start = LLVMBuildExtractValue(state->llvm_builder, items[i], 0, "");
+				LLVMValueRef end = LLVMBuildExtractValue(state->llvm_builder, items[i], 1, "");
+				LLVMIntPredicate predicate = is_type_signed(for_data->for_.types[i].value->range_type.type.value) ? LLVMIntSLT : LLVMIntULT;
+				LLVMValueRef not_empty = LLVMBuildICmp(state->llvm_builder, predicate, start, end, "");
+				len = LLVMBuildSelect(state->llvm_builder, not_empty, LLVMBuildSub(state->llvm_builder, end, start, ""), LLVMConstNull(LLVMTypeOf(end)), "");
 				break;
 			}
 			case STRING_TYPE_VALUE: {
@@ -1435,7 +2438,7 @@ static LLVMValueRef generate_for(Node *node, State *state) {
 		min_len = LLVMBuildSelect(state->llvm_builder, condition, len, min_len, "");
 	}
 
-	LLVMValueRef i = LLVMBuildAlloca(state->llvm_builder, LLVMInt64TypeInContext(state->llvm_context), "");
+	LLVMValueRef i = build_alloca(state, LLVMInt64TypeInContext(state->llvm_context));
 	LLVMBuildStore(state->llvm_builder, LLVMConstInt(LLVMInt64TypeInContext(state->llvm_context), 0, false), i);
 	LLVMBuildBr(state->llvm_builder, check_block);
 	LLVMPositionBuilderAtEnd(state->llvm_builder, check_block);
@@ -1461,7 +2464,13 @@ static LLVMValueRef generate_for(Node *node, State *state) {
 			}
 			case RANGE_TYPE_VALUE: {
 				LLVMValueRef start = LLVMBuildExtractValue(state->llvm_builder, items[i], 0, "");
-				LLVMValueRef element = LLVMBuildAdd(state->llvm_builder, start, i_value, "");
+				// Elements stay below the range end, so stepping towards it cannot overflow
+				LLVMValueRef element;
+				if (is_overflow_undefined(for_data->for_.types[i].value->range_type.type.value)) {
+					element = LLVMBuildNSWAdd(state->llvm_builder, start, i_value, "");
+				} else {
+					element = LLVMBuildNUWAdd(state->llvm_builder, start, i_value, "");
+				}
 
 				arrpush(bindings, element);
 				break;
@@ -1485,13 +2494,14 @@ static LLVMValueRef generate_for(Node *node, State *state) {
 	For_Codegen_Data for_codegen_data = {
 		.bindings = bindings
 	};
-	hmput(state->fors, for_data, for_codegen_data);
+	get_slot(state, for_data)->for_ = for_codegen_data;
 
 	generate_node(for_.body, state);
 
-	LLVMBuildStore(state->llvm_builder, LLVMBuildAdd(state->llvm_builder, LLVMBuildLoad2(state->llvm_builder, LLVMInt64TypeInContext(state->llvm_context), i, ""), LLVMConstInt(LLVMInt64TypeInContext(state->llvm_context), 1, false), ""), i);
+	LLVMBuildStore(state->llvm_builder, LLVMBuildNUWAdd(state->llvm_builder, LLVMBuildLoad2(state->llvm_builder, LLVMInt64TypeInContext(state->llvm_context), i, ""), LLVMConstInt(LLVMInt64TypeInContext(state->llvm_context), 1, false), ""), i);
 
-	LLVMBuildBr(state->llvm_builder, check_block);
+	LLVMValueRef back_edge = LLVMBuildBr(state->llvm_builder, check_block);
+	annotate_for_loop(state, back_edge, !loop_has_calls(body_block, check_block, done_block));
 	LLVMPositionBuilderAtEnd(state->llvm_builder, done_block);
 
 	return NULL;
@@ -1503,7 +2513,7 @@ static LLVMValueRef generate_range(Node *node, State *state) {
 	Value range_type = get_type(&state->context, node);
 	LLVMTypeRef range_type_llvm = create_llvm_type(range_type.value, state);
 
-	LLVMValueRef range_value = LLVMBuildAlloca(state->llvm_builder, range_type_llvm, "");
+	LLVMValueRef range_value = build_alloca(state, range_type_llvm);
 
 	LLVMValueRef start_pointer = LLVMBuildStructGEP2(state->llvm_builder, range_type_llvm, range_value, 0, "");
 	LLVMBuildStore(state->llvm_builder, generate_node(range.start, state), start_pointer);
@@ -1530,44 +2540,21 @@ static LLVMValueRef generate_internal(Node *node, State *state) {
 			return generate_node(internal_data.node, state);
 		case INTERNAL_SIZE_OF:
 			return generate_value(internal_data.value.value, type.value, state);
-		case INTERNAL_OK: {
-			LLVMTypeRef result_type = create_llvm_type(type.value, state);
-			LLVMValueRef result_value = LLVMBuildAlloca(state->llvm_builder, result_type, "");
-
-			LLVMValueRef tag_pointer = LLVMBuildStructGEP2(state->llvm_builder, result_type, result_value, 0, "");
-			LLVMValueRef data_pointer = LLVMBuildStructGEP2(state->llvm_builder, result_type, result_value, 1, "");
-
-			LLVMBuildStore(state->llvm_builder, LLVMConstInt(LLVMInt64TypeInContext(state->llvm_context), 0, false), tag_pointer);
-			if (arrlen(internal.inputs) > 0) {
-				data_pointer = LLVMBuildBitCast(state->llvm_builder, data_pointer, LLVMPointerType(create_llvm_type(type.value->result_type.value.value, state), 0), "");
-				LLVMBuildStore(state->llvm_builder, generate_node(internal.inputs[0], state), data_pointer);
-			}
-
-			return LLVMBuildLoad2(state->llvm_builder, result_type, result_value, "");
-		}
+		case INTERNAL_OK:
 		case INTERNAL_ERR: {
-			LLVMTypeRef result_type = create_llvm_type(type.value, state);
-			LLVMValueRef result_value = LLVMBuildAlloca(state->llvm_builder, result_type, "");
-
-			LLVMValueRef tag_pointer = LLVMBuildStructGEP2(state->llvm_builder, result_type, result_value, 0, "");
-			LLVMValueRef data_pointer = LLVMBuildStructGEP2(state->llvm_builder, result_type, result_value, 1, "");
-
-			LLVMBuildStore(state->llvm_builder, LLVMConstInt(LLVMInt64TypeInContext(state->llvm_context), 1, false), tag_pointer);
-			data_pointer = LLVMBuildBitCast(state->llvm_builder, data_pointer, LLVMPointerType(create_llvm_type(type.value->result_type.error.value, state), 0), "");
-			if (arrlen(internal.inputs) > 0) LLVMBuildStore(state->llvm_builder, generate_node(internal.inputs[0], state), data_pointer);
-
-			return LLVMBuildLoad2(state->llvm_builder, result_type, result_value, "");
+			LLVMValueRef payload = arrlen(internal.inputs) > 0 ? generate_node(internal.inputs[0], state) : NULL;
+			return build_variant(type.value, internal.kind == INTERNAL_OK ? 0 : 1, payload, state);
 		}
 		case INTERNAL_CONTEXT: {
 			if (internal.assign_value != NULL) {
 				LLVMValueRef value = generate_node(internal.assign_value, state);
-				LLVMBuildStore(state->llvm_builder, value, state->context_var);
+				LLVMBuildStore(state->llvm_builder, value, get_context_var(state));
 				return NULL;
 			} else {
 				if (internal_data.want_pointer) {
-					return state->context_var;
+					return get_context_var(state);
 				} else {
-					return LLVMBuildLoad2(state->llvm_builder, create_llvm_type(state->context.context_type.value, state), state->context_var, "");
+					return LLVMBuildLoad2(state->llvm_builder, create_llvm_type(state->context.context_type.value, state), get_context_var(state), "");
 				}
 			}
 		}
@@ -1615,7 +2602,7 @@ static LLVMValueRef generate_slice(Node *node, State *state) {
 			LLVMValueRef length = LLVMBuildSub(state->llvm_builder, end_llvm_value, start_llvm_value, "");
 
 			LLVMTypeRef array_view_llvm_type = create_llvm_type(create_array_view_type(slice_data.item_type).value, state);
-			LLVMValueRef array_view_allocated_llvm_value = LLVMBuildAlloca(state->llvm_builder, array_view_llvm_type, "");
+			LLVMValueRef array_view_allocated_llvm_value = build_alloca(state, array_view_llvm_type);
 			LLVMBuildStore(state->llvm_builder, length, LLVMBuildStructGEP2(state->llvm_builder, array_view_llvm_type, array_view_allocated_llvm_value, 0, ""));
 			LLVMBuildStore(state->llvm_builder, pointer, LLVMBuildStructGEP2(state->llvm_builder, array_view_llvm_type, array_view_allocated_llvm_value, 1, ""));
 
@@ -1626,7 +2613,7 @@ static LLVMValueRef generate_slice(Node *node, State *state) {
 			LLVMValueRef pointer = LLVMBuildGEP2(state->llvm_builder, LLVMArrayType2(create_llvm_type(array_type.value->array_view_type.inner.value, state), 0), LLVMBuildExtractValue(state->llvm_builder, array_llvm_value, 1, ""), indices, 2, "");
 			LLVMValueRef length = LLVMBuildSub(state->llvm_builder, end_llvm_value, start_llvm_value, "");
 
-			LLVMValueRef array_view_allocated_llvm_value = LLVMBuildAlloca(state->llvm_builder, array_view_llvm_type, "");
+			LLVMValueRef array_view_allocated_llvm_value = build_alloca(state, array_view_llvm_type);
 			LLVMBuildStore(state->llvm_builder, length, LLVMBuildStructGEP2(state->llvm_builder, array_view_llvm_type, array_view_allocated_llvm_value, 0, ""));
 			LLVMBuildStore(state->llvm_builder, pointer, LLVMBuildStructGEP2(state->llvm_builder, array_view_llvm_type, array_view_allocated_llvm_value, 1, ""));
 
@@ -1734,6 +2721,38 @@ static LLVMValueRef generate_node(Node *node, State *state) {
 	}
 }
 
+static bool is_allocation_function(String_View name) {
+	const char *names[] = { "malloc", "calloc", "realloc", "aligned_alloc" };
+	for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+		if (name.len == strlen(names[i]) && memcmp(name.ptr, names[i], name.len) == 0) return true;
+	}
+	return false;
+}
+
+static void add_function_attributes(LLVMValueRef llvm_function, Function_Value function, Function_Abi *abi, State *state) {
+	add_abi_attributes(state, llvm_function, abi);
+
+	String_View extern_name = function.node->function.extern_;
+	if (abi->c_abi && is_allocation_function(extern_name) && LLVMGetTypeKind(LLVMGetReturnType(abi->llvm_type)) == LLVMPointerTypeKind) {
+		add_attribute(llvm_function, LLVMAttributeReturnIndex, create_attribute(state, "noalias", 0));
+	}
+}
+
+static LLVMValueRef generate_extern_function(Value_Data *value, State *state) {
+	assert(value->tag == FUNCTION_VALUE);
+	Function_Value function = value->function;
+
+	LLVMValueRef llvm_function = hmget(state->extern_functions, function.node);
+	if (llvm_function != NULL) return llvm_function;
+
+	Function_Abi abi = get_function_abi(function.type, true, state);
+	llvm_function = LLVMAddFunction(state->llvm_module, "", abi.llvm_type);
+	LLVMSetValueName2(llvm_function, function.node->function.extern_.ptr, function.node->function.extern_.len);
+	add_function_attributes(llvm_function, function, &abi, state);
+	hmput(state->extern_functions, function.node, llvm_function);
+	return llvm_function;
+}
+
 static LLVMValueRef generate_function(Value_Data *value, State *state) {
 	assert(value->tag == FUNCTION_VALUE);
 	Function_Value function = value->function;
@@ -1746,8 +2765,10 @@ static LLVMValueRef generate_function(Value_Data *value, State *state) {
 		return NULL;
 	}
 
-	LLVMValueRef llvm_function = LLVMAddFunction(state->llvm_module, "", create_llvm_function_literal_type(function.type, state));
-	LLVMSetValueName2(llvm_function, function.node->function.extern_.ptr, function.node->function.extern_.len);
+	Function_Abi abi = get_function_abi(function.type, false, state);
+	LLVMValueRef llvm_function = LLVMAddFunction(state->llvm_module, "", abi.llvm_type);
+	LLVMSetLinkage(llvm_function, LLVMInternalLinkage);
+	add_function_attributes(llvm_function, function, &abi, state);
 	hmput(state->generated_cache, value, llvm_function);
 
 	LLVMBuilderRef saved_llvm_builder = state->llvm_builder;
@@ -1756,44 +2777,50 @@ static LLVMValueRef generate_function(Value_Data *value, State *state) {
 	LLVMValueRef saved_current_function = state->current_function;
 	LLVMValueRef *saved_function_arguments = state->function_arguments;
 	LLVMValueRef saved_context_var = state->context_var;
+	bool saved_copy_context = state->copy_context;
+	Function_Abi *saved_function_abi = state->function_abi;
 	state->current_function = llvm_function;
 	state->function_arguments = NULL;
 	state->context_var = NULL;
+	state->copy_context = function_data.writes_context;
+	state->function_abi = &abi;
 
-	if (function.body != NULL) {
+	bool extern_ = function.node->function.extern_.ptr != NULL;
+	if (function.body != NULL || extern_) {
 		LLVMBasicBlockRef entry = LLVMAppendBasicBlockInContext(state->llvm_context, llvm_function, "");
 		LLVMPositionBuilderAtEnd(state->llvm_builder, entry);
 
-		long int j = 0;
-		for (long int i = 0; i < arrlen(function.type->function_type.arguments); i++) {
-			if (function.type->function_type.arguments[i].static_) continue;
-
-			LLVMTypeRef type = create_llvm_type(function.type->function_type.arguments[i].type.value, state);
-			LLVMValueRef allocated = LLVMBuildAlloca(state->llvm_builder, type, "");
-			LLVMBuildStore(state->llvm_builder, LLVMGetParam(llvm_function, j), allocated);
-			arrpush(state->function_arguments, allocated);
-			j++;
+		for (long int i = 0; i < arrlen(abi.arguments); i++) {
+			arrpush(state->function_arguments, store_abi_parameters(state, &abi.arguments[i]));
 		}
 
-		LLVMValueRef context_allocated = LLVMBuildAlloca(state->llvm_builder, create_llvm_type(state->context.context_type.value, state), "");
-		LLVMBuildStore(state->llvm_builder, LLVMBuildLoad2(state->llvm_builder, create_llvm_type(state->context.context_type.value, state), LLVMGetParam(llvm_function, LLVMCountParams(llvm_function) - 1), ""), context_allocated);
-		state->context_var = context_allocated;
-
-		State_Variables variables = state->variables;
-		state->variables = NULL;
-		LLVMValueRef value = generate_node(function.body, state);
-		state->variables = variables;
+		if (extern_) {
+			// Extern functions used as values get this wrapper, so every function value shares one calling convention
+			LLVMValueRef *llvm_values = NULL;
+			for (long int i = 0; i < arrlen(abi.arguments); i++) {
+				arrpush(llvm_values, LLVMBuildLoad2(state->llvm_builder, abi.arguments[i].type, state->function_arguments[i], ""));
+			}
 
-		if (!function_data.returned) {
-			if (function.type->function_type.return_type.value != NULL) {
-				LLVMBuildRet(state->llvm_builder, value);
-			} else {
-				LLVMBuildRetVoid(state->llvm_builder);
+			Function_Abi c_abi = get_function_abi(function.type, true, state);
+			LLVMValueRef result = build_abi_call(state, &c_abi, generate_extern_function(value, state), llvm_values, NULL, false);
+			build_abi_return(state, result);
+		} else {
+			Slot_Codegen_Data *slots = state->slots;
+			state->slots = NULL;
+			arrsetlen(state->slots, function_data.slot_count);
+			memset(state->slots, 0, sizeof(Slot_Codegen_Data) * function_data.slot_count);
+			LLVMValueRef value = generate_node(function.body, state);
+			state->slots = slots;
+
+			if (!function_data.returned) {
+				build_abi_return(state, value);
 			}
 		}
 	}
 
+	state->function_abi = saved_function_abi;
 	state->context_var = saved_context_var;
+	state->copy_context = saved_copy_context;
 	state->function_arguments = saved_function_arguments;
 	state->current_function = saved_current_function;
 	state->context.static_id = saved_static_argument_id;
@@ -1818,6 +2845,13 @@ static LLVMValueRef generate_integer(Value_Data *value, Value_Data *type, State
 	return LLVMConstInt(create_llvm_type(type, state), integer.value, false);
 }
 
+static LLVMValueRef generate_float(Value_Data *value, Value_Data *type, State *state) {
+	assert(value->tag == FLOAT_VALUE);
+	Float_Value float_ = value->float_;
+
+	return LLVMConstReal(create_llvm_type(type, state), float_.value);
+}
+
 static LLVMValueRef generate_byte(Value_Data *value, State *state) {
 	(void) state;
 	assert(value->tag == BYTE_VALUE);
@@ -1844,6 +2878,18 @@ static LLVMValueRef generate_struct(Value_Data *value, Value_Data *type, State *
 	return struct_value;
 }
 
+static LLVMValueRef generate_array(Value_Data *value, Value_Data *type, State *state) {
+	Array_Value array = value->array;
+
+	Value_Data *inner_type = type->array_type.inner.value;
+
+	LLVMValueRef array_value = LLVMGetUndef(create_llvm_type(type, state));
+	for (long int i = 0; i < arrlen(array.values); i++) {
+		array_value = LLVMBuildInsertValue(state->llvm_builder, array_value, generate_value(array.values[i], inner_type, state), i, "");
+	}
+	return array_value;
+}
+
 static LLVMValueRef generate_array_view(Value_Data *value, Value_Data *type, State *state) {
 	Array_View_Value array_view = value->array_view;
 
@@ -1916,12 +2962,18 @@ static LLVMValueRef generate_value(Value_Data *value, Value_Data *type, State *s
 		case INTEGER_VALUE:
 			result = generate_integer(value, type, state);
 			break;
+		case FLOAT_VALUE:
+			result = generate_float(value, type, state);
+			break;
 		case BYTE_VALUE:
 			result = generate_byte(value, state);
 			break;
 		case ENUM_VALUE:
 			result = generate_enum(value, state);
 			break;
+		case ARRAY_VALUE:
+			result = generate_array(value, type, state);
+			break;
 		case ARRAY_VIEW_VALUE:
 			result = generate_array_view(value, type, state);
 			break;
@@ -1966,7 +3018,7 @@ static void generate_main(State *state) {
 	if (state->main_takes_arguments) {
 		LLVMValueRef argc = LLVMGetParam(llvm_function, 0);
 		LLVMValueRef argv = LLVMGetParam(llvm_function, 1);
-		LLVMValueRef i = LLVMBuildAlloca(state->llvm_builder, LLVMInt64TypeInContext(state->llvm_context), "");
+		LLVMValueRef i = build_alloca(state, LLVMInt64TypeInContext(state->llvm_context));
 		LLVMBuildStore(state->llvm_builder, LLVMConstInt(LLVMInt64TypeInContext(state->llvm_context), 0, false), i);
 
 		LLVMTypeRef string_type = create_llvm_type(create_array_view_type(create_value(BYTE_TYPE_VALUE)).value, state);
@@ -1995,7 +3047,7 @@ static void generate_main(State *state) {
 		LLVMBasicBlockRef start_length_loop = LLVMAppendBasicBlockInContext(state->llvm_context, llvm_function, "");
 		LLVMBasicBlockRef end_length_loop = LLVMAppendBasicBlockInContext(state->llvm_context, llvm_function, "");
 
-		LLVMValueRef j = LLVMBuildAlloca(state->llvm_builder, LLVMInt64TypeInContext(state->llvm_context), "");
+		LLVMValueRef j = build_alloca(state, LLVMInt64TypeInContext(state->llvm_context));
 		LLVMBuildStore(state->llvm_builder, LLVMConstInt(LLVMInt64TypeInContext(state->llvm_context), 0, false), j);
 
 		LLVMBuildBr(state->llvm_builder, start_length_check);
@@ -2009,47 +3061,105 @@ static void generate_main(State *state) {
 		LLVMValueRef length_cmp_result = LLVMBuildICmp(state->llvm_builder, LLVMIntNE, LLVMBuildLoad2(state->llvm_builder, LLVMInt8TypeInContext(state->llvm_context), LLVMBuildGEP2(state->llvm_builder, LLVMArrayType2(LLVMInt8TypeInContext(state->llvm_context), 0), raw_string_value, indices2, 2, ""), ""), LLVMConstInt(LLVMInt8TypeInContext(state->llvm_context), 0, false), "");
 		LLVMBuildCondBr(state->llvm_builder, length_cmp_result, start_length_loop, end_length_loop);
 		LLVMPositionBuilderAtEnd(state->llvm_builder, start_length_loop);
-		LLVMBuildStore(state->llvm_builder, LLVMBuildAdd(state->llvm_builder, LLVMBuildLoad2(state->llvm_builder, LLVMInt64TypeInContext(state->llvm_context), j, ""), LLVMConstInt(LLVMInt64TypeInContext(state->llvm_context), 1, false), ""), j);
+		LLVMBuildStore(state->llvm_builder, LLVMBuildNUWAdd(state->llvm_builder, LLVMBuildLoad2(state->llvm_builder, LLVMInt64TypeInContext(state->llvm_context), j, ""), LLVMConstInt(LLVMInt64TypeInContext(state->llvm_context), 1, false), ""), j);
 		LLVMBuildBr(state->llvm_builder, start_length_check);
 		LLVMPositionBuilderAtEnd(state->llvm_builder, end_length_loop);
 
-		LLVMValueRef arg = LLVMBuildAlloca(state->llvm_builder, string_type, "");
+		LLVMValueRef arg = build_alloca(state, string_type);
 		LLVMBuildStore(state->llvm_builder, LLVMBuildLoad2(state->llvm_builder, LLVMInt64TypeInContext(state->llvm_context), j, ""), LLVMBuildStructGEP2(state->llvm_builder, string_type, arg, 0, ""));
 		LLVMBuildStore(state->llvm_builder, raw_string_value, LLVMBuildStructGEP2(state->llvm_builder, string_type, arg, 1, ""));
 
 		LLVMValueRef array_i_ptr = LLVMBuildGEP2(state->llvm_builder, LLVMArrayType2(string_type, 0), array, indices, 2, "");
 		LLVMBuildStore(state->llvm_builder, LLVMBuildLoad2(state->llvm_builder, string_type, arg, ""), array_i_ptr);
 
-		LLVMBuildStore(state->llvm_builder, LLVMBuildAdd(state->llvm_builder, LLVMBuildLoad2(state->llvm_builder, LLVMInt64TypeInContext(state->llvm_context), i, ""), LLVMConstInt(LLVMInt64TypeInContext(state->llvm_context), 1, false), ""), i);
+		LLVMBuildStore(state->llvm_builder, LLVMBuildNUWAdd(state->llvm_builder, LLVMBuildLoad2(state->llvm_builder, LLVMInt64TypeInContext(state->llvm_context), i, ""), LLVMConstInt(LLVMInt64TypeInContext(state->llvm_context), 1, false), ""), i);
 
 		LLVMBuildBr(state->llvm_builder, start_check);
 		LLVMPositionBuilderAtEnd(state->llvm_builder, end_loop);
 
 		LLVMTypeRef args_view_type = create_llvm_type(create_array_view_type(create_array_view_type(create_value(BYTE_TYPE_VALUE))).value, state);
-		LLVMValueRef args_view = LLVMBuildAlloca(state->llvm_builder, args_view_type, "");
+		LLVMValueRef args_view = build_alloca(state, args_view_type);
 		LLVMBuildStore(state->llvm_builder, LLVMBuildZExt(state->llvm_builder, argc, LLVMInt64TypeInContext(state->llvm_context), ""), LLVMBuildStructGEP2(state->llvm_builder, args_view_type, args_view, 0, ""));
 		LLVMBuildStore(state->llvm_builder, array, LLVMBuildStructGEP2(state->llvm_builder, args_view_type, args_view, 1, ""));
 
 		arrpush(arguments, LLVMBuildLoad2(state->llvm_builder, args_view_type, args_view, ""));
 	}
 
-	LLVMValueRef context_allocated = LLVMBuildAlloca(state->llvm_builder, create_llvm_type(state->context.context_type.value, state), "");
+	LLVMValueRef context_allocated = build_alloca(state, create_llvm_type(state->context.context_type.value, state));
 	arrpush(arguments, context_allocated);
 
 	LLVMBuildCall2(state->llvm_builder, LLVMGlobalGetValueType(state->main_function), state->main_function, arguments, arrlen(arguments), "");
 	LLVMBuildRetVoid(state->llvm_builder);
 }
 
-typedef struct {
-	LLVMContextRef context;
-	LLVMModuleRef module;
-	LLVMTargetMachineRef target_machine;
-} LLVM_Data;
+// Only musttail calls constrain the convention, plain tail markers are added freely by the optimizer and mergefunc
+static bool makes_tail_calls(LLVMValueRef function) {
+	for (LLVMBasicBlockRef block = LLVMGetFirstBasicBlock(function); block != NULL; block = LLVMGetNextBasicBlock(block)) {
+		for (LLVMValueRef instruction = LLVMGetFirstInstruction(block); instruction != NULL; instruction = LLVMGetNextInstruction(instruction)) {
+			if (LLVMIsACallInst(instruction) != NULL && LLVMGetTailCallKind(instruction) == LLVMTailCallKindMustTail) return true;
+		}
+	}
+	return false;
+}
+
+// Internal functions that are only ever called directly can use fastcc, anything whose address escapes keeps the C convention of indirect calls
+// Tail calls need the caller and callee conventions to match, so both sides of one keep the C convention
+static void assign_calling_conventions(LLVMModuleRef llvm_module) {
+	for (LLVMValueRef function = LLVMGetFirstFunction(llvm_module); function != NULL; function = LLVMGetNextFunction(function)) {
+		if (LLVMIsDeclaration(function) || LLVMGetLinkage(function) != LLVMInternalLinkage) continue;
+		if (LLVMIsFunctionVarArg(LLVMGlobalGetValueType(function))) continue;
+		if (makes_tail_calls(function)) continue;
+
+		bool called_directly = true;
+		for (LLVMUseRef use = LLVMGetFirstUse(function); use != NULL && called_directly; use = LLVMGetNextUse(use)) {
+			LLVMValueRef user = LLVMGetUser(use);
+			if (LLVMIsACallInst(user) == NULL || LLVMGetCalledValue(user) != function || LLVMGetTailCallKind(user) == LLVMTailCallKindMustTail) {
+				called_directly = false;
+				break;
+			}
+
+			for (int i = 0; i < LLVMGetNumOperands(user) - 1; i++) {
+				if (LLVMGetOperand(user, i) == function) {
+					called_directly = false;
+					break;
+				}
+			}
+		}
+
+		if (!called_directly) continue;
+
+		LLVMSetFunctionCallConv(function, LLVMFastCallConv);
+		for (LLVMUseRef use = LLVMGetFirstUse(function); use != NULL; use = LLVMGetNextUse(use)) {
+			LLVMSetInstructionCallConv(LLVMGetUser(use), LLVMFastCallConv);
+		}
+	}
+}
+
+// The C API has no function sections switch, so every definition gets its own .text.* section for --gc-sections
+static void assign_function_sections(LLVMModuleRef llvm_module) {
+	size_t index = 0;
+	for (LLVMValueRef function = LLVMGetFirstFunction(llvm_module); function != NULL; function = LLVMGetNextFunction(function)) {
+		if (LLVMIsDeclaration(function)) continue;
+
+		size_t name_length = 0;
+		const char *name = LLVMGetValueName2(function, &name_length);
+
+		char section[64];
+		if (name_length > 0 && name_length < sizeof(section) - 7) {
+			snprintf(section, sizeof(section), ".text.%.*s", (int) name_length, name);
+		} else {
+			snprintf(section, sizeof(section), ".text.%zu", index);
+		}
+		LLVMSetSection(function, section);
+		index++;
+	}
+}
 
 size_t size_llvm(Value_Data *value, void *data) {
-	State state = { .llvm_target = ((LLVM_Data *) data)->target_machine, .llvm_context = ((LLVM_Data *) data)->context };
+	LLVM_Data *llvm_data = data;
+	State state = { .llvm_target = llvm_data->target_machine, .llvm_context = llvm_data->context, .llvm_data = llvm_data };
 	LLVMTypeRef llvm_type = create_llvm_type(value, &state);
-	return LLVMABISizeOfType(LLVMCreateTargetDataLayout(state.llvm_target), llvm_type);
+	return LLVMABISizeOfType(llvm_data->target_data, llvm_type);
 }
 
 size_t c_size_llvm(C_Size_Fn_Input input) {
@@ -2067,9 +3177,10 @@ size_t c_size_llvm(C_Size_Fn_Input input) {
 }
 
 size_t alignment_llvm(Value_Data *value, void *data) {
-	State state = { .llvm_target = ((LLVM_Data *) data)->target_machine };
+	LLVM_Data *llvm_data = data;
+	State state = { .llvm_target = llvm_data->target_machine, .llvm_context = llvm_data->context, .llvm_data = llvm_data };
 	LLVMTypeRef llvm_type = create_llvm_type(value, &state);
-	return LLVMABIAlignmentOfType(LLVMCreateTargetDataLayout(state.llvm_target), llvm_type);
+	return LLVMABIAlignmentOfType(llvm_data->target_data, llvm_type);
 }
 
 void build_llvm(Context context, Node *root, void *data) {
@@ -2084,14 +3195,37 @@ void build_llvm(Context context, Node *root, void *data) {
 		.context = context,
 		.llvm_module = llvm_module,
 		.llvm_builder = NULL,
+		.llvm_alloca_builder = LLVMCreateBuilderInContext(llvm_context),
 		.llvm_target = llvm_target_machine,
 		.llvm_context = llvm_context,
+		.llvm_data = data,
 		.generated_cache = NULL
 	};
 
 	generate_node(root, &state);
 	generate_main(&state);
 
+	// Instantiations that differ only in types of identical layout lower to the same IR and get folded into one body
+	// Arguments only live in registers once promoted, which lets readonly and nocapture be inferred for pointer arguments
+	char *pipeline = "function(mem2reg),function-attrs,mergefunc,globaldce";
+	LLVMPassBuilderOptionsRef pass_options = LLVMCreatePassBuilderOptions();
+	if (((LLVM_Data *) data)->optimize) {
+		// The O2 pipeline is what acts on the TBAA, llvm.loop, noalias and overflow flag information we emit
+		pipeline = "default<O2>,mergefunc,globaldce";
+		LLVMPassBuilderOptionsSetLoopVectorization(pass_options, true);
+		LLVMPassBuilderOptionsSetSLPVectorization(pass_options, true);
+	}
+	LLVMErrorRef pass_error = LLVMRunPasses(llvm_module, pipeline, llvm_target_machine, pass_options);
+	if (pass_error != NULL) {
+		char *message = LLVMGetErrorMessage(pass_error);
+		printf("%s\n", message);
+		LLVMDisposeErrorMessage(message);
+	}
+	LLVMDisposePassBuilderOptions(pass_options);
+
+	assign_calling_conventions(llvm_module);
+	assign_function_sections(llvm_module);
+
 	LLVMPrintModuleToFile(llvm_module, "output.ll", NULL);
 
 	char *error = NULL;
@@ -2106,6 +3240,7 @@ void build_llvm(Context context, Node *root, void *data) {
 		char *args[] = {
 			"gcc",
 			"-no-pie",
+			"-Wl,--gc-sections",
 			"output.o",
 			"-o",
 			"output",
@@ -2117,7 +3252,7 @@ void build_llvm(Context context, Node *root, void *data) {
 	}
 }
 
-Codegen llvm_codegen() {
+Codegen llvm_codegen(bool fast_math, bool optimize) {
 	LLVMContextRef llvm_context = LLVMContextCreate();
     LLVMModuleRef llvm_module = LLVMModuleCreateWithNameInContext("main", llvm_context);
 
@@ -2131,14 +3266,18 @@ Codegen llvm_codegen() {
 	LLVMGetTargetFromTriple(LLVMGetDefaultTargetTriple(), &target, NULL);
 	LLVMTargetMachineRef target_machine = LLVMCreateTargetMachine(
 		target, LLVMGetDefaultTargetTriple(), "generic", "",
-		LLVMCodeGenLevelNone, LLVMRelocDefault, LLVMCodeModelDefault
+		optimize ? LLVMCodeGenLevelDefault : LLVMCodeGenLevelNone, LLVMRelocDefault, LLVMCodeModelDefault
 	);
 	LLVMSetTarget(llvm_module, LLVMGetDefaultTargetTriple());
 
 	LLVM_Data *data = malloc(sizeof(LLVM_Data));
+	memset(data, 0, sizeof(LLVM_Data));
 	data->module = llvm_module;
 	data->target_machine = target_machine;
+	data->target_data = LLVMCreateTargetDataLayout(target_machine);
 	data->context = llvm_context;
+	data->fast_math = fast_math;
+	data->optimize = optimize;
 
 	return (Codegen) {
 		.size_fn = size_llvm,
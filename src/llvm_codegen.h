@@ -1,4 +1,4 @@
 #include "ast.h"
 #include "common.h"
 
-Codegen llvm_codegen();
+Codegen llvm_codegen(bool fast_math, bool optimize);
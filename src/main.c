@@ -3,6 +3,7 @@
 #include <string.h>
 
 #include "common.h"
+#include "compiler.h"
 #include "llvm_codegen.h"
 #include "parser.h"
 #include "processor.h"
@@ -11,38 +12,85 @@
 
 #include "stb/ds.h"
 
+static void usage(char *program) {
+	printf("Usage: %s [-O] [-ffast-math] [-I DIRECTORY]... [SOURCE]\n", program);
+	exit(1);
+}
+
 int main(int argc, char **argv) {
-	if (argc != 2) {
-		printf("Usage: %s [SOURCE]\n", argv[0]);
-		return 1;
+	Compiler *compiler = compiler_create();
+	current_compiler = compiler;
+
+	Data data = {
+		.mutex = PTHREAD_MUTEX_INITIALIZER,
+		.work_available = PTHREAD_COND_INITIALIZER,
+		.job_finished = PTHREAD_COND_INITIALIZER
+	};
+
+	// Modules are searched in -I directories, then LANG_PATH entries, then ./modules
+	char *source_file = NULL;
+	bool fast_math = false;
+	bool optimize = false;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-I") == 0) {
+			if (i + 1 == argc) usage(argv[0]);
+			add_module_path(&data, argv[++i]);
+		} else if (strncmp(argv[i], "-I", 2) == 0) {
+			add_module_path(&data, argv[i] + 2);
+		} else if (strcmp(argv[i], "-O") == 0) {
+			optimize = true;
+		} else if (strcmp(argv[i], "-ffast-math") == 0) {
+			fast_math = true;
+		} else if (source_file == NULL) {
+			source_file = argv[i];
+		} else {
+			usage(argv[0]);
+		}
 	}
 
-	Data data = {};
+	if (source_file == NULL) usage(argv[0]);
+
+	char *lang_path = getenv("LANG_PATH");
+	if (lang_path != NULL) {
+		char *paths = strdup(lang_path);
+		for (char *path = strtok(paths, ":"); path != NULL; path = strtok(NULL, ":")) {
+			add_module_path(&data, path);
+		}
+	}
+
+	add_module_path(&data, "modules");
 
-	char *source_file = argv[1];
 	Node *root = parse_file(&data, realpath(source_file, NULL));
+	parse_prefetch(&data, root);
 
 	Node *internal_root = parse_source(&data, (char *) src_internal_lang, src_internal_lang_len, "internal");
 
-	Codegen codegen = llvm_codegen();
+	Codegen codegen = llvm_codegen(fast_math, optimize);
 
-	Context context = { .codegen = codegen, .data = &data, .static_id = 1 };
+	Context context = { .codegen = codegen, .data = &data, .static_id = 1, .compiler = compiler };
 	arrsetcap(context.scopes, 32);
 
 	process_module_root(&context, internal_root);
 
 	Scope internal_scope = {
 		.node = internal_root,
-		.identifiers = NULL
+		.identifiers = NULL,
+		.has_static_id = true,
+		.static_id = 1
 	};
 
 	context.internal_root = internal_root;
 	context.internal_scope = internal_scope;
-	context.context_type = get_data(&context, find_define(context.internal_root, cstr_to_sv("Context")))->define.typed_value.value;
+	context.context_type = process_root_define(&context, internal_root, cstr_to_sv("Context")).value;
 
 	process_module_root(&context, root);
+	process_root_define(&context, root, cstr_to_sv("main"));
+	process_pending_functions(&context);
 
 	codegen.build_fn(context, root, codegen.data);
 
+	parse_stop(&data);
+	compiler_destroy(compiler);
+
 	return 0;
 }
@@ -1,30 +1,46 @@
 #include <assert.h>
+#include <fcntl.h>
+#include <setjmp.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "stb/ds.h"
 
 #include "ast.h"
+#include "compiler.h"
 #include "lexer.h"
 #include "parser.h"
 #include "util.h"
 
+// Set while a background thread parses ahead, so failures are left for the processor to report in order
+static _Thread_local jmp_buf *parse_recover = NULL;
+
 static void handle_token_error(Lexer *lexer, Token_Kind expected, Token_Data actual) {
-	printf("%s:%u:%u: Unexpected token '%s', expected '%s'\n", lexer->path, actual.location.row, actual.location.column, token_to_string(actual.kind), token_to_string(expected));
+	if (parse_recover != NULL) longjmp(*parse_recover, 1);
+
+	Source_Position position = source_position(lexer->data, actual.location);
+	printf("%s:%u:%u: Unexpected token '%s', expected '%s'\n", position.path, position.row, position.column, token_to_string(actual.kind), token_to_string(expected));
 	exit(1);
 }
 
 static void handle_token_error_no_expected(Lexer *lexer, Token_Data actual) {
-	printf("%s:%u:%u: Unexpected token '%s'\n", lexer->path, actual.location.row, actual.location.column, token_to_string(actual.kind));
+	if (parse_recover != NULL) longjmp(*parse_recover, 1);
+
+	Source_Position position = source_position(lexer->data, actual.location);
+	printf("%s:%u:%u: Unexpected token '%s'\n", position.path, position.row, position.column, token_to_string(actual.kind));
 	exit(1);
 }
 
 static Token_Data lexer_peek(Lexer *lexer) {
-	return lexer_next(lexer, false);
+	return lexer_token(lexer, lexer->token_index);
 }
 
 static Token_Data lexer_consume(Lexer *lexer) {
-	return lexer_next(lexer, true);
+	return lexer_token(lexer, lexer->token_index++);
 }
 
 static bool lexer_peek_check(Lexer *lexer, Token_Kind kind) {
@@ -33,7 +49,7 @@ static bool lexer_peek_check(Lexer *lexer, Token_Kind kind) {
 }
 
 static Token_Data lexer_consume_check(Lexer *lexer, Token_Kind kind) {
-	Token_Data data = lexer_next(lexer, true);
+	Token_Data data = lexer_consume(lexer);
 	if (data.kind != kind) {
 		handle_token_error(lexer, kind, data);
 	}
@@ -41,6 +57,20 @@ static Token_Data lexer_consume_check(Lexer *lexer, Token_Kind kind) {
 	return data;
 }
 
+// Child lists are collected on the lexer's scratch stack and copied out at their final size
+#define scratch_push(lexer, value) do { \
+	typeof(value) scratch_value = (value); \
+	memcpy(arraddnptr((lexer)->scratch, sizeof(scratch_value)), &scratch_value, sizeof(scratch_value)); \
+} while (0)
+
+#define scratch_commit(lexer, mark, type) ((type *) scratch_commit_list(lexer, mark, sizeof(type)))
+
+static void *scratch_commit_list(Lexer *lexer, size_t mark, size_t element_size) {
+	void *list = ast_list_new(lexer->scratch + mark, (arrlenu(lexer->scratch) - mark) / element_size, element_size);
+	arrsetlen(lexer->scratch, mark);
+	return list;
+}
+
 static Node *parse_expression(Lexer *lexer);
 static Node *parse_statement(Lexer *lexer);
 
@@ -76,7 +106,7 @@ static Node *parse_separated_statement_or_nothing(Lexer *lexer) {
 static Node *parse_string(Lexer *lexer) {
 	Token_Data token = lexer_consume_check(lexer, STRING);
 
-	Node *string = ast_new(STRING_NODE, token.location);
+	Node *string = node_at(ast_new(STRING_NODE, token.location));
 	string->string.value = token.string;
 
 	return string;
@@ -85,7 +115,7 @@ static Node *parse_string(Lexer *lexer) {
 static Node *parse_character(Lexer *lexer) {
 	Token_Data token = lexer_consume_check(lexer, CHARACTER);
 
-	Node *character = ast_new(CHARACTER_NODE, token.location);
+	Node *character = node_at(ast_new(CHARACTER_NODE, token.location));
 	character->character.value = token.string;
 
 	return character;
@@ -94,7 +124,7 @@ static Node *parse_character(Lexer *lexer) {
 static Node *parse_number(Lexer *lexer) {
 	Token_Data token = lexer_consume(lexer);
 
-	Node *number = ast_new(NUMBER_NODE, token.location);
+	Node *number = node_at(ast_new(NUMBER_NODE, token.location));
 	if (token.kind == INTEGER) {
 		number->number.tag = INTEGER_NUMBER;
 		number->number.integer = token.integer;
@@ -109,8 +139,8 @@ static Node *parse_number(Lexer *lexer) {
 static Node *parse_structure(Lexer *lexer) {
 	Token_Data token = lexer_consume_check(lexer, PERIOD_CURLY_BRACE_OPEN);
 
-	Node *structure = ast_new(STRUCTURE_NODE, token.location);
-	structure->structure.values = NULL;
+	Node *structure = node_at(ast_new(STRUCTURE_NODE, token.location));
+	size_t values_mark = arrlenu(lexer->scratch);
 
 	if (lexer_peek(lexer).kind != CURLY_BRACE_CLOSED) {
 		while (true) {
@@ -127,7 +157,7 @@ static Node *parse_structure(Lexer *lexer) {
 				.node = argument,
 				.identifier = identifier
 			};
-			arrpush(structure->structure.values, item_value);
+			scratch_push(lexer, item_value);
 
 			Token_Data token = lexer_peek(lexer);
 			if (token.kind == COMMA) {
@@ -142,11 +172,12 @@ static Node *parse_structure(Lexer *lexer) {
 
 	lexer_consume_check(lexer, CURLY_BRACE_CLOSED);
 
+	structure->structure.values = scratch_commit(lexer, values_mark, Structure_Argument);
 	return structure;
 }
 
 static Node *parse_actual_identifier(Token_Data token, bool polymorphic) {
-	Node *identifier = ast_new(IDENTIFIER_NODE, token.location);
+	Node *identifier = node_at(ast_new(IDENTIFIER_NODE, token.location));
 	identifier->identifier.value = token.string;
 	identifier->identifier.assign_value = NULL;
 	identifier->identifier.polymorphic = polymorphic;
@@ -165,15 +196,23 @@ static Node *parse_declaration(Lexer *lexer, bool polymorphic, String_View ident
 	if (next.kind == COLON) {
 		lexer_consume(lexer);
 
-		Node *define = ast_new(DEFINE_NODE, location);
+		Node *define = node_at(ast_new(DEFINE_NODE, location));
 		define->define.identifier = identifier;
 		define->define.public = true;
 		define->define.type = type;
 		define->define.expression = parse_expression(lexer);
+
+		Node *expression = define->define.expression;
+		if (expression->kind == FUNCTION_NODE && expression->function.body != NULL && expression->function.body->kind == STRUCT_TYPE_NODE) {
+			expression = expression->function.body;
+		}
+		if (expression->kind == STRUCT_TYPE_NODE) {
+			expression->struct_type.name = identifier;
+		}
 		return define;
 	}
 
-	Node *variable = ast_new(VARIABLE_NODE, location);
+	Node *variable = node_at(ast_new(VARIABLE_NODE, location));
 	variable->variable.name = identifier;
 	variable->variable.polymorphic = polymorphic;
 	variable->variable.static_ = polymorphic;
@@ -194,12 +233,12 @@ static Node *parse_identifier(Lexer *lexer, bool polymorphic) {
 	switch (token.string.ptr[0]) {
 		case 'b':
 			if (sv_eq_cstr(token.string, "bool")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_BOOL;
 				internal->internal.assign_value = NULL;
 				return internal;
 			} else if (sv_eq_cstr(token.string, "byte")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_BYTE;
 				internal->internal.assign_value = NULL;
 				return internal;
@@ -207,7 +246,7 @@ static Node *parse_identifier(Lexer *lexer, bool polymorphic) {
 			break;
 		case 'c':
 			if (sv_eq_cstr(token.string, "compile_error")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_COMPILE_ERROR;
 				internal->internal.inputs = NULL;
 				internal->internal.assign_value = NULL;
@@ -218,7 +257,7 @@ static Node *parse_identifier(Lexer *lexer, bool polymorphic) {
 
 				return internal;
 			} else if (sv_eq_cstr(token.string, "context")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_CONTEXT;
 				internal->internal.assign_value = NULL;
 				return internal;
@@ -226,22 +265,22 @@ static Node *parse_identifier(Lexer *lexer, bool polymorphic) {
 			break;
 		case 'C':
 			if (sv_eq_cstr(token.string, "C_CHAR_SIZE")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_C_CHAR_SIZE;
 				internal->internal.assign_value = NULL;
 				return internal;
 			} else if (sv_eq_cstr(token.string, "C_SHORT_SIZE")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_C_SHORT_SIZE;
 				internal->internal.assign_value = NULL;
 				return internal;
 			} else if (sv_eq_cstr(token.string, "C_INT_SIZE")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_C_INT_SIZE;
 				internal->internal.assign_value = NULL;
 				return internal;
 			} else if (sv_eq_cstr(token.string, "C_LONG_SIZE")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_C_LONG_SIZE;
 				internal->internal.assign_value = NULL;
 				return internal;
@@ -249,7 +288,7 @@ static Node *parse_identifier(Lexer *lexer, bool polymorphic) {
 			break;
 		case 'e':
 			if (sv_eq_cstr(token.string, "embed")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_EMBED;
 				internal->internal.inputs = NULL;
 				internal->internal.assign_value = NULL;
@@ -265,7 +304,7 @@ static Node *parse_identifier(Lexer *lexer, bool polymorphic) {
 
 				return internal;
 			} else if (sv_eq_cstr(token.string, "err")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_ERR;
 				internal->internal.inputs = NULL;
 				internal->internal.assign_value = NULL;
@@ -281,7 +320,7 @@ static Node *parse_identifier(Lexer *lexer, bool polymorphic) {
 			break;
 		case 'g':
 			if (sv_eq_cstr(token.string, "global_value")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_GLOBAL_VALUE;
 				internal->internal.assign_value = NULL;
 
@@ -294,11 +333,11 @@ static Node *parse_identifier(Lexer *lexer, bool polymorphic) {
 			break;
 		case 'f':
 			if (sv_eq_cstr(token.string, "false")) {
-				Node *boolean = ast_new(BOOLEAN_NODE, token.location);
+				Node *boolean = node_at(ast_new(BOOLEAN_NODE, token.location));
 				boolean->boolean.value = false;
 				return boolean;
 			} else if (sv_eq_cstr(token.string, "flt64")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_FLT64;
 				internal->internal.assign_value = NULL;
 				return internal;
@@ -306,7 +345,7 @@ static Node *parse_identifier(Lexer *lexer, bool polymorphic) {
 			break;
 		case 'i':
 			if (sv_eq_cstr(token.string, "int")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_INT;
 				internal->internal.assign_value = NULL;
 				return internal;
@@ -314,12 +353,12 @@ static Node *parse_identifier(Lexer *lexer, bool polymorphic) {
 			break;
 		case 'n':
 			if (sv_eq_cstr(token.string, "null")) {
-				return ast_new(NULL_NODE, token.location);
+				return node_at(ast_new(NULL_NODE, token.location));
 			}
 			break;
 		case 'o':
 			if (sv_eq_cstr(token.string, "ok")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_OK;
 				internal->internal.inputs = NULL;
 				internal->internal.assign_value = NULL;
@@ -335,7 +374,7 @@ static Node *parse_identifier(Lexer *lexer, bool polymorphic) {
 			break;
 		case 'O':
 			if (sv_eq_cstr(token.string, "OS")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_OS;
 				internal->internal.assign_value = NULL;
 				return internal;
@@ -343,7 +382,7 @@ static Node *parse_identifier(Lexer *lexer, bool polymorphic) {
 			break;
 		case 'p':
 			// if (sv_eq_cstr(token.string, "print")) {
-			// 	Node *internal = ast_new(INTERNAL_NODE, token.location);
+			// 	Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 			// 	internal->internal.kind = INTERNAL_PRINT;
 
 			// 	lexer_consume_check(lexer, PARENTHESIS_OPEN);
@@ -359,17 +398,17 @@ static Node *parse_identifier(Lexer *lexer, bool polymorphic) {
 			break;
 		case 's':
 			if (sv_eq_cstr(token.string, "self")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_SELF;
 				internal->internal.assign_value = NULL;
 				return internal;
 			} else if (sv_eq_cstr(token.string, "sint")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_SINT;
 				internal->internal.assign_value = NULL;
 				return internal;
 			} else if (sv_eq_cstr(token.string, "size_of")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_SIZE_OF;
 				internal->internal.inputs = NULL;
 				internal->internal.assign_value = NULL;
@@ -380,27 +419,27 @@ static Node *parse_identifier(Lexer *lexer, bool polymorphic) {
 
 				return internal;
 			} else if (sv_eq_cstr(token.string, "s8")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_S8;
 				internal->internal.assign_value = NULL;
 				return internal;
 			} else if (sv_eq_cstr(token.string, "s16")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_S16;
 				internal->internal.assign_value = NULL;
 				return internal;
 			} else if (sv_eq_cstr(token.string, "s32")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_S32;
 				internal->internal.assign_value = NULL;
 				return internal;
 			} else if (sv_eq_cstr(token.string, "s64")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_S64;
 				internal->internal.assign_value = NULL;
 				return internal;
 			} else if (sv_eq_cstr(token.string, "string")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_STRING;
 				internal->internal.assign_value = NULL;
 				return internal;
@@ -408,16 +447,16 @@ static Node *parse_identifier(Lexer *lexer, bool polymorphic) {
 			break;
 		case 't':
 			if (sv_eq_cstr(token.string, "true")) {
-				Node *boolean = ast_new(BOOLEAN_NODE, token.location);
+				Node *boolean = node_at(ast_new(BOOLEAN_NODE, token.location));
 				boolean->boolean.value = true;
 				return boolean;
 			} else if (sv_eq_cstr(token.string, "type")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_TYPE;
 				internal->internal.assign_value = NULL;
 				return internal;
 			} else if (sv_eq_cstr(token.string, "type_of")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_TYPE_OF;
 				internal->internal.inputs = NULL;
 				internal->internal.assign_value = NULL;
@@ -428,7 +467,7 @@ static Node *parse_identifier(Lexer *lexer, bool polymorphic) {
 
 				return internal;
 			} else if (sv_eq_cstr(token.string, "type_info_of")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_TYPE_INFO_OF;
 				internal->internal.inputs = NULL;
 				internal->internal.assign_value = NULL;
@@ -442,7 +481,7 @@ static Node *parse_identifier(Lexer *lexer, bool polymorphic) {
 			break;
 		case 'T':
 			if (sv_eq_cstr(token.string, "Type")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_TYPE;
 				internal->internal.assign_value = NULL;
 				return internal;
@@ -450,32 +489,32 @@ static Node *parse_identifier(Lexer *lexer, bool polymorphic) {
 			break;
 		case 'u':
 			if (sv_eq_cstr(token.string, "uint")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_UINT;
 				internal->internal.assign_value = NULL;
 				return internal;
 			} else if (sv_eq_cstr(token.string, "uint8")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_UINT8;
 				internal->internal.assign_value = NULL;
 				return internal;
 			} else if (sv_eq_cstr(token.string, "u8")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_U8;
 				internal->internal.assign_value = NULL;
 				return internal;
 			} else if (sv_eq_cstr(token.string, "u16")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_U8;
 				internal->internal.assign_value = NULL;
 				return internal;
 			} else if (sv_eq_cstr(token.string, "u32")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_U32;
 				internal->internal.assign_value = NULL;
 				return internal;
 			} else if (sv_eq_cstr(token.string, "u64")) {
-				Node *internal = ast_new(INTERNAL_NODE, token.location);
+				Node *internal = node_at(ast_new(INTERNAL_NODE, token.location));
 				internal->internal.kind = INTERNAL_U64;
 				internal->internal.assign_value = NULL;
 				return internal;
@@ -496,7 +535,7 @@ static Node *parse_identifier(Lexer *lexer, bool polymorphic) {
 static Node *parse_result(Lexer *lexer, Node *node) {
 	Token_Data token = lexer_consume(lexer);
 
-	Node *result = ast_new(RESULT_NODE, token.location);
+	Node *result = node_at(ast_new(RESULT_NODE, token.location));
 	result->result_type.value = node;
 	result->result_type.error = parse_expression(lexer);
 	return result;
@@ -507,7 +546,7 @@ static Node *parse_range(Lexer *lexer, Node *start) {
 
 	Node *end = parse_expression_or_nothing(lexer);
 
-	Node *range = ast_new(RANGE_NODE, token.location);
+	Node *range = node_at(ast_new(RANGE_NODE, token.location));
 	range->range.start = start;
 	range->range.end = end;
 
@@ -517,7 +556,7 @@ static Node *parse_range(Lexer *lexer, Node *start) {
 static Node *parse_is(Lexer *lexer, Node *node) {
 	Token_Data token = lexer_consume(lexer);
 
-	Node *is = ast_new(IS_NODE, token.location);
+	Node *is = node_at(ast_new(IS_NODE, token.location));
 	is->is.node = node;
 	is->is.check = parse_expression(lexer);
 	return is;
@@ -526,7 +565,7 @@ static Node *parse_is(Lexer *lexer, Node *node) {
 static Node *parse_catch(Lexer *lexer, Node *node) {
 	Token_Data token = lexer_consume(lexer);
 
-	Node *catch = ast_new(CATCH_NODE, token.location);
+	Node *catch = node_at(ast_new(CATCH_NODE, token.location));
 	catch->catch.value = node;
 	catch->catch.binding = (String_View) {};
 
@@ -544,9 +583,9 @@ static Node *parse_catch(Lexer *lexer, Node *node) {
 static Node *parse_call(Lexer *lexer, Node *function) {
 	Token_Data first_token = lexer_consume_check(lexer, PARENTHESIS_OPEN);
 
-	Node *call = ast_new(CALL_NODE, first_token.location);
+	Node *call = node_at(ast_new(CALL_NODE, first_token.location));
 	call->call.function = function;
-	call->call.arguments = NULL;
+	size_t arguments_mark = arrlenu(lexer->scratch);
 
 	if (lexer_peek(lexer).kind != PARENTHESIS_CLOSED) {
 		while (true) {
@@ -563,7 +602,7 @@ static Node *parse_call(Lexer *lexer, Node *function) {
 				.identifier = identifier,
 				.node = argument
 			};
-			arrpush(call->call.arguments, call_argument);
+			scratch_push(lexer, call_argument);
 
 			Token_Data token = lexer_peek(lexer);
 			if (token.kind == COMMA) {
@@ -578,19 +617,20 @@ static Node *parse_call(Lexer *lexer, Node *function) {
 
 	lexer_consume_check(lexer, PARENTHESIS_CLOSED);
 
+	call->call.arguments = scratch_commit(lexer, arguments_mark, Call_Argument);
 	return call;
 }
 
-static void add_inferred_arguments(Function_Argument **arguments, Node *argument) {
+static void add_inferred_arguments(Lexer *lexer, Node *argument) {
 	if (argument == NULL) return;
 
 	switch (argument->kind) {
 		case ARRAY_TYPE_NODE:
-			add_inferred_arguments(arguments, argument->array_type.size);
-			add_inferred_arguments(arguments, argument->array_type.inner);
+			add_inferred_arguments(lexer, argument->array_type.size);
+			add_inferred_arguments(lexer, argument->array_type.inner);
 			break;
 		case ARRAY_VIEW_TYPE_NODE:
-			add_inferred_arguments(arguments, argument->array_view_type.inner);
+			add_inferred_arguments(lexer, argument->array_view_type.inner);
 			break;
 		case IDENTIFIER_NODE: {
 			Identifier_Node *identifier = &argument->identifier;
@@ -600,16 +640,16 @@ static void add_inferred_arguments(Function_Argument **arguments, Node *argument
 					.static_ = true,
 					.inferred = true
 				};
-				arrpush(*arguments, argument);
+				scratch_push(lexer, argument);
 			}
 			break;
 		}
 		case POINTER_NODE:
-			add_inferred_arguments(arguments, argument->pointer_type.inner);
+			add_inferred_arguments(lexer, argument->pointer_type.inner);
 			break;
 		case CALL_NODE:
 			for (int i = 0; i < arrlen(argument->call.arguments); i++) {
-				add_inferred_arguments(arguments, argument->call.arguments[i].node);
+				add_inferred_arguments(lexer, argument->call.arguments[i].node);
 			}
 			break;
 		case INTERNAL_NODE:
@@ -625,7 +665,7 @@ typedef struct {
 } Parse_Arguments_Result;
 
 static Parse_Arguments_Result parse_arguments(Lexer *lexer) {
-	Function_Argument *arguments = NULL;
+	size_t arguments_mark = arrlenu(lexer->scratch);
 
 	lexer_consume_check(lexer, PARENTHESIS_OPEN);
 
@@ -636,16 +676,23 @@ static Parse_Arguments_Result parse_arguments(Lexer *lexer) {
 				lexer_consume(lexer);
 				variadic = true;
 			} else {
+				bool noalias = false;
+				if (lexer_peek_check(lexer, KEYWORD_NOALIAS)) {
+					lexer_consume(lexer);
+					noalias = true;
+				}
+
 				Node *argument_node = parse_expression(lexer);
 
 				Function_Argument argument = {
 					.identifier = argument_node->variable.name,
 					.type = argument_node->variable.type,
 					.default_value = argument_node->variable.value,
-					.static_ = argument_node->variable.polymorphic
+					.static_ = argument_node->variable.polymorphic,
+					.noalias = noalias
 				};
-				add_inferred_arguments(&arguments, argument_node->variable.type);
-				arrpush(arguments, argument);
+				add_inferred_arguments(lexer, argument_node->variable.type);
+				scratch_push(lexer, argument);
 			}
 
 			Token_Data token = lexer_peek(lexer);
@@ -662,7 +709,7 @@ static Parse_Arguments_Result parse_arguments(Lexer *lexer) {
 	lexer_consume_check(lexer, PARENTHESIS_CLOSED);
 
 	return (Parse_Arguments_Result) {
-		.arguments = arguments,
+		.arguments = scratch_commit(lexer, arguments_mark, Function_Argument),
 		.variadic = variadic
 	};
 }
@@ -681,9 +728,13 @@ static size_t get_precedence(Binary_Op_Node_Kind kind) {
 		case OP_MULTIPLY:
 		case OP_DIVIDE:
 		case OP_MODULUS:
+		case OP_BITWISE_AND:
+		case OP_SHIFT_LEFT:
+		case OP_SHIFT_RIGHT:
 			return 3;
 		case OP_ADD:
 		case OP_SUBTRACT:
+		case OP_BITWISE_XOR:
 			return 2;
 		case OP_EQUALS:
 		case OP_NOT_EQUALS:
@@ -704,7 +755,7 @@ static size_t get_precedence(Binary_Op_Node_Kind kind) {
 static Node *parse_binary_operator(Lexer *lexer, Node *left) {
 	Token_Data first_token = lexer_consume(lexer);
 
-	Node *binary_operator = ast_new(BINARY_OP_NODE, first_token.location);
+	Node *binary_operator = node_at(ast_new(BINARY_OP_NODE, first_token.location));
 	binary_operator->binary_op.left = left;
 	switch (first_token.kind) {
 		case EQUALS_EQUALS:
@@ -740,6 +791,18 @@ static Node *parse_binary_operator(Lexer *lexer, Node *left) {
 		case PERCENT:
 			binary_operator->binary_op.operator = OP_MODULUS;
 			break;
+		case AMPERSAND:
+			binary_operator->binary_op.operator = OP_BITWISE_AND;
+			break;
+		case CARET:
+			binary_operator->binary_op.operator = OP_BITWISE_XOR;
+			break;
+		case LESS_LESS:
+			binary_operator->binary_op.operator = OP_SHIFT_LEFT;
+			break;
+		case GREATER_GREATER:
+			binary_operator->binary_op.operator = OP_SHIFT_RIGHT;
+			break;
 		case KEYWORD_AND:
 			binary_operator->binary_op.operator = OP_AND;
 			break;
@@ -775,7 +838,7 @@ static Node *parse_structure_access(Lexer *lexer, Node *structure) {
 	if (member.kind == ASTERISK) {
 		lexer_consume(lexer);
 
-		Node *dereference = ast_new(DEREFERENCE_NODE, first_token.location);
+		Node *dereference = node_at(ast_new(DEREFERENCE_NODE, first_token.location));
 		dereference->dereference.node = structure;
 		dereference->dereference.assign_value = NULL;
 
@@ -783,13 +846,13 @@ static Node *parse_structure_access(Lexer *lexer, Node *structure) {
 	} else if (member.kind == QUESTION) {
 		lexer_consume(lexer);
 
-		Node *dereference = ast_new(DEOPTIONAL_NODE, first_token.location);
+		Node *dereference = node_at(ast_new(DEOPTIONAL_NODE, first_token.location));
 		dereference->dereference.node = structure;
 		dereference->dereference.assign_value = NULL;
 
 		return dereference;
 	} else {
-		Node *structure_access = ast_new(STRUCTURE_ACCESS_NODE, first_token.location);
+		Node *structure_access = node_at(ast_new(STRUCTURE_ACCESS_NODE, first_token.location));
 		structure_access->structure_access.parent = structure;
 		structure_access->structure_access.name = lexer_consume_check(lexer, IDENTIFIER).string;
 		structure_access->structure_access.assign_value = NULL;
@@ -806,7 +869,7 @@ static Node *parse_array_access_or_slice(Lexer *lexer, Node *array) {
 	if (lexer_peek(lexer).kind == COMMA) {
 		lexer_consume(lexer);
 
-		Node *slice = ast_new(SLICE_NODE, first_token.location);
+		Node *slice = node_at(ast_new(SLICE_NODE, first_token.location));
 		slice->slice.parent = array;
 		slice->slice.start = first;
 		slice->slice.end = parse_expression(lexer);
@@ -814,7 +877,7 @@ static Node *parse_array_access_or_slice(Lexer *lexer, Node *array) {
 		lexer_consume_check(lexer, BRACE_CLOSED);
 		return slice;
 	} else {
-		Node *array_access = ast_new(ARRAY_ACCESS_NODE, first_token.location);
+		Node *array_access = node_at(ast_new(ARRAY_ACCESS_NODE, first_token.location));
 		array_access->array_access.parent = array;
 		array_access->array_access.index = first;
 		array_access->array_access.assign_value = NULL;
@@ -855,16 +918,17 @@ static Node *parse_assign(Lexer *lexer, Node *target) {
 static Node *parse_struct_type(Lexer *lexer) {
 	Token_Data first_token = lexer_consume(lexer);
 
-	Node *struct_ = ast_new(STRUCT_TYPE_NODE, first_token.location);
+	Node *struct_ = node_at(ast_new(STRUCT_TYPE_NODE, first_token.location));
 	
 	struct_->struct_type.inherit_function = false;
+	struct_->struct_type.name = (String_View) {};
 	Function_Argument *arguments = NULL;
 	if (lexer_peek(lexer).kind == PARENTHESIS_OPEN) {
 		arguments = parse_arguments(lexer).arguments;
 		struct_->struct_type.inherit_function = true;
 	}
 
-	struct_->struct_type.members = NULL;
+	size_t members_mark = arrlenu(lexer->scratch);
 	lexer_consume_check(lexer, CURLY_BRACE_OPEN);
 	while (lexer_peek(lexer).kind != CURLY_BRACE_CLOSED) {
 		Token_Data identifier = lexer_consume_check(lexer, IDENTIFIER);
@@ -875,20 +939,21 @@ static Node *parse_struct_type(Lexer *lexer) {
 			.name = identifier.string,
 			.type = type
 		};
-		arrpush(struct_->struct_type.members, member);
+		scratch_push(lexer, member);
 
 		lexer_consume_check(lexer, SEMICOLON);
 	}
 
 	lexer_consume_check(lexer, CURLY_BRACE_CLOSED);
+	struct_->struct_type.members = scratch_commit(lexer, members_mark, Structure_Member);
 
 	if (arguments) {
-		Node *function_type = ast_new(FUNCTION_TYPE_NODE, first_token.location);
+		Node *function_type = node_at(ast_new(FUNCTION_TYPE_NODE, first_token.location));
 		function_type->function_type.arguments = arguments;
 		function_type->function_type.variadic = false;
 		function_type->function_type.return_ = NULL;
 
-		Node *function = ast_new(FUNCTION_NODE, first_token.location);
+		Node *function = node_at(ast_new(FUNCTION_NODE, first_token.location));
 		function->function.function_type = function_type;
 		function->function.body = struct_;
 		function->function.static_id_counter = 0;
@@ -902,8 +967,9 @@ static Node *parse_struct_type(Lexer *lexer) {
 static Node *parse_union_type(Lexer *lexer) {
 	Token_Data first_token = lexer_consume(lexer);
 
-	Node *union_ = ast_new(UNION_TYPE_NODE, first_token.location);
+	Node *union_ = node_at(ast_new(UNION_TYPE_NODE, first_token.location));
 
+	size_t members_mark = arrlenu(lexer->scratch);
 	lexer_consume_check(lexer, CURLY_BRACE_OPEN);
 	if (lexer_peek(lexer).kind != CURLY_BRACE_CLOSED) {
 		while (true) {
@@ -915,7 +981,7 @@ static Node *parse_union_type(Lexer *lexer) {
 				.name = name,
 				.type = type
 			};
-			arrpush(union_->union_type.members, member);
+			scratch_push(lexer, member);
 
 			Token_Data token = lexer_peek(lexer);
 			if (token.kind == COMMA) {
@@ -928,6 +994,7 @@ static Node *parse_union_type(Lexer *lexer) {
 		}
 	}
 	lexer_consume_check(lexer, CURLY_BRACE_CLOSED);
+	union_->union_type.members = scratch_commit(lexer, members_mark, Structure_Member);
 
 	return union_;
 }
@@ -935,9 +1002,9 @@ static Node *parse_union_type(Lexer *lexer) {
 static Node *parse_tagged_union_type(Lexer *lexer) {
 	Token_Data first_token = lexer_consume(lexer);
 
-	Node *tagged_union = ast_new(TAGGED_UNION_TYPE_NODE, first_token.location);
+	Node *tagged_union = node_at(ast_new(TAGGED_UNION_TYPE_NODE, first_token.location));
 
-	tagged_union->tagged_union_type.members = NULL;
+	size_t members_mark = arrlenu(lexer->scratch);
 	lexer_consume_check(lexer, CURLY_BRACE_OPEN);
 	while (lexer_peek(lexer).kind != CURLY_BRACE_CLOSED) {
 		String_View name = lexer_consume_check(lexer, IDENTIFIER).string;
@@ -948,11 +1015,12 @@ static Node *parse_tagged_union_type(Lexer *lexer) {
 			.name = name,
 			.type = type
 		};
-		arrpush(tagged_union->tagged_union_type.members, member);
+		scratch_push(lexer, member);
 
 		lexer_consume_check(lexer, SEMICOLON);
 	}
 	lexer_consume_check(lexer, CURLY_BRACE_CLOSED);
+	tagged_union->tagged_union_type.members = scratch_commit(lexer, members_mark, Structure_Member);
 
 	return tagged_union;
 }
@@ -960,18 +1028,19 @@ static Node *parse_tagged_union_type(Lexer *lexer) {
 static Node *parse_enum_type(Lexer *lexer) {
 	Token_Data first_token = lexer_consume(lexer);
 
-	Node *enum_ = ast_new(ENUM_TYPE_NODE, first_token.location);
+	Node *enum_ = node_at(ast_new(ENUM_TYPE_NODE, first_token.location));
 
-	enum_->enum_type.items = NULL;
+	size_t items_mark = arrlenu(lexer->scratch);
 	lexer_consume_check(lexer, CURLY_BRACE_OPEN);
 	while (lexer_peek(lexer).kind != CURLY_BRACE_CLOSED) {
 		Token_Data identifier = lexer_consume_check(lexer, IDENTIFIER);
 
-		arrpush(enum_->enum_type.items, identifier.string);
+		scratch_push(lexer, identifier.string);
 
 		lexer_consume_check(lexer, SEMICOLON);
 	}
 	lexer_consume_check(lexer, CURLY_BRACE_CLOSED);
+	enum_->enum_type.items = scratch_commit(lexer, items_mark, String_View);
 
 	return enum_;
 }
@@ -979,8 +1048,15 @@ static Node *parse_enum_type(Lexer *lexer) {
 static Node *parse_return(Lexer *lexer) {
 	Token_Data first_token = lexer_consume(lexer);
 
-	Node *return_ = ast_new(RETURN_NODE, first_token.location);
+	bool tail = false;
+	if (first_token.kind == KEYWORD_TAIL) {
+		lexer_consume_check(lexer, KEYWORD_RETURN);
+		tail = true;
+	}
+
+	Node *return_ = node_at(ast_new(RETURN_NODE, first_token.location));
 	return_->return_.value = parse_expression_or_nothing(lexer);
+	return_->return_.tail = tail;
 
 	return return_;
 }
@@ -988,7 +1064,7 @@ static Node *parse_return(Lexer *lexer) {
 static Node *parse_break(Lexer *lexer) {
 	Token_Data first_token = lexer_consume(lexer);
 
-	Node *break_ = ast_new(BREAK_NODE, first_token.location);
+	Node *break_ = node_at(ast_new(BREAK_NODE, first_token.location));
 	break_->break_.value = parse_expression_or_nothing(lexer);
 
 	return break_;
@@ -997,7 +1073,7 @@ static Node *parse_break(Lexer *lexer) {
 static Node *parse_if(Lexer *lexer, bool static_) {
 	Token_Data first_token = lexer_consume(lexer);
 
-	Node *if_ = ast_new(IF_NODE, first_token.location);
+	Node *if_ = node_at(ast_new(IF_NODE, first_token.location));
 	if_->if_.static_ = static_;
 	if_->if_.condition = parse_expression(lexer);
 	if_->if_.bindings = NULL;
@@ -1035,7 +1111,7 @@ static Node *parse_if(Lexer *lexer, bool static_) {
 
 static Node *parse_while(Lexer *lexer, bool static_) {
 	Token_Data first_token = lexer_consume(lexer);
-	Node *while_ = ast_new(WHILE_NODE, first_token.location);
+	Node *while_ = node_at(ast_new(WHILE_NODE, first_token.location));
 	while_->while_.static_id_counter = 0;
 	while_->while_.static_ = static_;
 	while_->while_.condition = parse_expression(lexer);
@@ -1054,7 +1130,7 @@ static Node *parse_while(Lexer *lexer, bool static_) {
 static Node *parse_import(Lexer *lexer) {
 	Token_Data first_token = lexer_consume(lexer);
 
-	Node *import = ast_new(IMPORT_NODE, first_token.location);
+	Node *import = node_at(ast_new(IMPORT_NODE, first_token.location));
 	import->import.module = parse_expression(lexer);
 
 	return import;
@@ -1063,7 +1139,7 @@ static Node *parse_import(Lexer *lexer) {
 static Node *parse_load(Lexer *lexer) {
 	Token_Data first_token = lexer_consume(lexer);
 
-	Node *load = ast_new(LOAD_NODE, first_token.location);
+	Node *load = node_at(ast_new(LOAD_NODE, first_token.location));
 	load->load.path = parse_expression(lexer);
 	return load;
 }
@@ -1071,14 +1147,14 @@ static Node *parse_load(Lexer *lexer) {
 static Node *parse_for(Lexer *lexer, bool static_) {
 	Token_Data first_token = lexer_consume(lexer);
 
-	Node *for_ = ast_new(FOR_NODE, first_token.location);
+	Node *for_ = node_at(ast_new(FOR_NODE, first_token.location));
 	for_->for_.static_id_counter = 0;
 	for_->for_.static_ = static_;
 
-	for_->for_.items = NULL;
+	size_t items_mark = arrlenu(lexer->scratch);
 	bool has_more = true;
 	while (has_more) {
-		arrpush(for_->for_.items, parse_expression(lexer));
+		scratch_push(lexer, parse_expression(lexer));
 
 		if (lexer_peek(lexer).kind == COMMA) {
 			has_more = true;
@@ -1088,6 +1164,8 @@ static Node *parse_for(Lexer *lexer, bool static_) {
 		}
 	}
 
+	for_->for_.items = scratch_commit(lexer, items_mark, Node *);
+
 	for_->for_.bindings = NULL;
 	if (lexer_peek(lexer).kind == VERTICAL_BAR) {
 		lexer_consume_check(lexer, VERTICAL_BAR);
@@ -1115,7 +1193,7 @@ static Node *parse_for(Lexer *lexer, bool static_) {
 static Node *parse_global(Lexer *lexer) {
 	Token_Data first_token = lexer_consume(lexer);
 
-	Node *global = ast_new(GLOBAL_NODE, first_token.location);
+	Node *global = node_at(ast_new(GLOBAL_NODE, first_token.location));
 
 	if (lexer_peek_check(lexer, COLON)) {
 		lexer_consume(lexer);
@@ -1138,13 +1216,13 @@ static Node *parse_global(Lexer *lexer) {
 
 static Node *parse_switch(Lexer *lexer, bool static_) {
 	Token_Data first_token = lexer_consume(lexer);
-	Node *switch_ = ast_new(SWITCH_NODE, first_token.location);
+	Node *switch_ = node_at(ast_new(SWITCH_NODE, first_token.location));
 
 	switch_->switch_.static_ = static_;
 
 	switch_->switch_.condition = parse_expression(lexer);
 
-	switch_->switch_.cases = NULL;
+	size_t cases_mark = arrlenu(lexer->scratch);
 	lexer_consume_check(lexer, CURLY_BRACE_OPEN);
 	while (lexer_peek_check(lexer, KEYWORD_CASE)) {
 		lexer_consume(lexer);
@@ -1162,10 +1240,11 @@ static Node *parse_switch(Lexer *lexer, bool static_) {
 			.body = parse_separated_statement(lexer),
 			.binding = binding
 		};
-		arrpush(switch_->switch_.cases, switch_case);
+		scratch_push(lexer, switch_case);
 	}
 
 	lexer_consume_check(lexer, CURLY_BRACE_CLOSED);
+	switch_->switch_.cases = scratch_commit(lexer, cases_mark, Switch_Case);
 
 	return switch_;
 }
@@ -1178,13 +1257,13 @@ static bool needs_semicolon(Node *node) {
 static Node *parse_block(Lexer *lexer) {
 	Token_Data first_token = lexer_consume_check(lexer, CURLY_BRACE_OPEN);
 
-	Node *block = ast_new(BLOCK_NODE, first_token.location);
+	Node *block = node_at(ast_new(BLOCK_NODE, first_token.location));
 	block->block.has_result = false;
 
-	block->block.statements = NULL;
+	size_t statements_mark = arrlenu(lexer->scratch);
 	while (lexer_peek(lexer).kind != CURLY_BRACE_CLOSED) {
 		Node *statement = parse_statement(lexer);
-		arrpush(block->block.statements, statement);
+		scratch_push(lexer, statement);
 		if (lexer_peek(lexer).kind == CURLY_BRACE_CLOSED) {
 			block->block.has_result = true;
 		} else {
@@ -1197,6 +1276,7 @@ static Node *parse_block(Lexer *lexer) {
 	}
 
 	lexer_consume_check(lexer, CURLY_BRACE_CLOSED);
+	block->block.statements = scratch_commit(lexer, statements_mark, Node *);
 
 	return block;
 }
@@ -1204,7 +1284,7 @@ static Node *parse_block(Lexer *lexer) {
 static Node *parse_pointer(Lexer *lexer) {
 	Token_Data first_token = lexer_consume(lexer);
 
-	Node *pointer = ast_new(POINTER_NODE, first_token.location);
+	Node *pointer = node_at(ast_new(POINTER_NODE, first_token.location));
 	Node *inner = parse_expression_or_nothing(lexer);
 
 	Node *result;
@@ -1223,7 +1303,7 @@ static Node *parse_pointer(Lexer *lexer) {
 static Node *parse_optional(Lexer *lexer) {
 	Token_Data first_token = lexer_consume_check(lexer, QUESTION);
 
-	Node *optional = ast_new(OPTIONAL_NODE, first_token.location);
+	Node *optional = node_at(ast_new(OPTIONAL_NODE, first_token.location));
 	optional->optional_type.inner = parse_expression(lexer);
 
 	return optional;
@@ -1232,7 +1312,7 @@ static Node *parse_optional(Lexer *lexer) {
 static Node *parse_reference(Lexer *lexer) {
 	Token_Data first_token = lexer_consume_check(lexer, AMPERSAND);
 
-	Node *reference = ast_new(REFERENCE_NODE, first_token.location);
+	Node *reference = node_at(ast_new(REFERENCE_NODE, first_token.location));
 	reference->reference.node = parse_expression(lexer);
 
 	return reference;
@@ -1253,7 +1333,7 @@ static Node *parse_array_or_array_view_type(Lexer *lexer) {
 
 		lexer_consume_check(lexer, BRACE_CLOSED);
 
-		Node *array_type = ast_new(ARRAY_TYPE_NODE, first_token.location);
+		Node *array_type = node_at(ast_new(ARRAY_TYPE_NODE, first_token.location));
 		array_type->array_type.size = size;
 		array_type->array_type.sentinel = sentinel;
 		array_type->array_type.inner = parse_expression(lexer);
@@ -1261,7 +1341,7 @@ static Node *parse_array_or_array_view_type(Lexer *lexer) {
 	} else {
 		lexer_consume_check(lexer, BRACE_CLOSED);
 
-		Node *array_view_type = ast_new(ARRAY_VIEW_TYPE_NODE, first_token.location);
+		Node *array_view_type = node_at(ast_new(ARRAY_VIEW_TYPE_NODE, first_token.location));
 		array_view_type->array_view_type.inner = parse_expression(lexer);
 		return array_view_type;
 	}
@@ -1271,10 +1351,10 @@ static Node *parse_module_or_module_type(Lexer *lexer) {
 	Token_Data first_token = lexer_consume(lexer);
 
 	if (lexer_peek(lexer).kind != CURLY_BRACE_OPEN) {
-		return ast_new(MODULE_TYPE_NODE, first_token.location);
+		return node_at(ast_new(MODULE_TYPE_NODE, first_token.location));
 	}
 
-	Node *module = ast_new(MODULE_NODE, first_token.location);
+	Node *module = node_at(ast_new(MODULE_NODE, first_token.location));
 	Node *body = parse_expression(lexer);
 	module->module.body = body;
 	return module;
@@ -1283,7 +1363,7 @@ static Node *parse_module_or_module_type(Lexer *lexer) {
 static Node *parse_not(Lexer *lexer) {
 	Token_Data first_token = lexer_consume(lexer);
 
-	Node *not = ast_new(NOT_NODE, first_token.location);
+	Node *not = node_at(ast_new(NOT_NODE, first_token.location));
 	not->not.node = parse_expression(lexer);
 	return not;
 }
@@ -1309,6 +1389,18 @@ static Node *parse_op(Lexer *lexer) {
 		case PERCENT:
 			identifier = cstr_to_sv("%");
 			break;
+		case AMPERSAND:
+			identifier = cstr_to_sv("&");
+			break;
+		case CARET:
+			identifier = cstr_to_sv("^");
+			break;
+		case LESS_LESS:
+			identifier = cstr_to_sv("<<");
+			break;
+		case GREATER_GREATER:
+			identifier = cstr_to_sv(">>");
+			break;
 		case EQUALS_EQUALS:
 			identifier = cstr_to_sv("==");
 			break;
@@ -1359,14 +1451,14 @@ static Node *parse_op(Lexer *lexer) {
 
 static Node *parse_run(Lexer *lexer) {
 	Token_Data first_token = lexer_consume(lexer);
-	Node *run = ast_new(RUN_NODE, first_token.location);
+	Node *run = node_at(ast_new(RUN_NODE, first_token.location));
 	run->run.node = parse_expression(lexer);
 	return run;
 }
 
 static Node *parse_cast(Lexer *lexer) {
 	Token_Data first_token = lexer_consume(lexer);
-	Node *cast = ast_new(CAST_NODE, first_token.location);
+	Node *cast = node_at(ast_new(CAST_NODE, first_token.location));
 	lexer_consume_check(lexer, PARENTHESIS_OPEN);
 	cast->cast.type = parse_expression(lexer);
 	lexer_consume_check(lexer, PARENTHESIS_CLOSED);
@@ -1376,7 +1468,7 @@ static Node *parse_cast(Lexer *lexer) {
 
 static Node *parse_defer(Lexer *lexer) {
 	Token_Data first_token = lexer_consume(lexer);
-	Node *defer = ast_new(DEFER_NODE, first_token.location);
+	Node *defer = node_at(ast_new(DEFER_NODE, first_token.location));
 	defer->defer.node = parse_expression(lexer);
 	return defer;
 }
@@ -1402,7 +1494,7 @@ static Node *parse_function_or_function_type(Lexer *lexer) {
 		return_ = parse_expression(lexer);
 	}
 
-	Node *function_type = ast_new(FUNCTION_TYPE_NODE, first_token.location);
+	Node *function_type = node_at(ast_new(FUNCTION_TYPE_NODE, first_token.location));
 	function_type->function_type = (Function_Type_Node) {
 		.arguments = arguments,
 		.return_ = return_,
@@ -1419,14 +1511,14 @@ static Node *parse_function_or_function_type(Lexer *lexer) {
 	}
 
 	if (body != NULL || extern_.ptr != NULL) {
-		Node *function = ast_new(FUNCTION_NODE, first_token.location);
+		Node *function = node_at(ast_new(FUNCTION_NODE, first_token.location));
 		function->function.function_type = function_type;
 		function->function.body = body;
 		function->function.extern_ = extern_;
 		function->function.static_id_counter = 0;
 
 		if (has_static) {
-			Node *function_stub = ast_new(FUNCTION_STUB_NODE, first_token.location);
+			Node *function_stub = node_at(ast_new(FUNCTION_STUB_NODE, first_token.location));
 			function_stub->function_stub.node = function;
 			function = function_stub;
 		}
@@ -1563,7 +1655,8 @@ static Node *parse_expression(Lexer *lexer) {
 			result = parse_op(lexer);
 			break;
 		}
-		case KEYWORD_RETURN: {
+		case KEYWORD_RETURN:
+		case KEYWORD_TAIL: {
 			result = parse_return(lexer);
 			break;
 		}
@@ -1641,6 +1734,10 @@ static Node *parse_expression(Lexer *lexer) {
 			case ASTERISK:
 			case SLASH:
 			case PERCENT:
+			case AMPERSAND:
+			case CARET:
+			case LESS_LESS:
+			case GREATER_GREATER:
 			case KEYWORD_AND:
 			case KEYWORD_OR:
 				result = parse_binary_operator(lexer, result);
@@ -1672,25 +1769,42 @@ static Node *parse_expression(Lexer *lexer) {
 	return result;
 }
 
-Node *parse_source_statement(Data *data, char *source, size_t length, size_t path_ref, size_t row, size_t column) {
-	(void) data;
-	Lexer lexer = lexer_create(source, length, path_ref);
-	lexer.constant_row_column = true;
-	lexer.row = row;
-	lexer.column = column + 1;
+Node *parse_source_statement(Data *data, char *source, size_t length, Source_Location location) {
+	Lexer lexer = lexer_create(source, length, 0);
+	lexer.data = data;
+	lexer.constant_location = true;
+	lexer.location = location;
+	lexer_tokenize(&lexer);
 	return parse_statement(&lexer);
 }
 
 Node *parse_source(Data *data, char *source, size_t length, char *path) {
-	Lexer lexer = lexer_create(source, length, arrlen(data->source_files));
-	arrpush(data->source_files, path);
-	lexer.path = path;
+	Source_File source_file = {
+		.path = path,
+		.source = source,
+		.length = length
+	};
+	pthread_mutex_lock(&data->mutex);
+	// Locations are 32-bit offsets into the concatenation of all loaded sources, so they must not wrap
+	if (length + 1 > UINT32_MAX - data->source_end) {
+		pthread_mutex_unlock(&data->mutex);
+		if (parse_recover != NULL) longjmp(*parse_recover, 1);
+		printf("Loading '%s' exceeds the 4 GiB of source that locations can address\n", path);
+		exit(1);
+	}
+	source_file.start = data->source_end;
+	arrpush(data->source_files, source_file);
+	data->source_end += length + 1;
+	pthread_mutex_unlock(&data->mutex);
+
+	Lexer lexer = lexer_create(source, length, source_file.start);
+	lexer.data = data;
+	lexer_tokenize(&lexer);
 
-	Node *root = ast_new(ROOT_NODE, (Source_Location) {});
-	root->root.statements = NULL;
+	Node *root = node_at(ast_new(ROOT_NODE, (Source_Location) {}));
 	while (lexer_peek(&lexer).kind != END_OF_FILE) {
 		Node *expression = parse_expression(&lexer);
-		arrpush(root->root.statements, expression);
+		scratch_push(&lexer, expression);
 
 		if (needs_semicolon(expression)) {
 			lexer_consume_check(&lexer, SEMICOLON);
@@ -1698,25 +1812,299 @@ Node *parse_source(Data *data, char *source, size_t length, char *path) {
 			lexer_consume(&lexer);
 		}
 	}
+	root->root.statements = scratch_commit(&lexer, 0, Node *);
 
 	return root;
 }
 
+static char *read_file_contents(int fd, size_t *length) {
+	size_t capacity = 65536;
+	size_t size = 0;
+	char *contents = malloc(capacity);
+	while (true) {
+		if (size + 1 >= capacity) {
+			capacity *= 2;
+			contents = realloc(contents, capacity);
+		}
+
+		ssize_t result = read(fd, contents + size, capacity - size);
+		if (result < 0) return NULL;
+		if (result == 0) break;
+		size += result;
+	}
+
+	contents[size] = '\0';
+	*length = size;
+	return contents;
+}
+
 Node *parse_file(Data *data, char *path) {
-	FILE *file = fopen(path, "r");
-	if (!file) {
+	int fd = path != NULL ? open(path, O_RDONLY) : -1;
+	if (fd < 0) {
+		if (parse_recover != NULL) longjmp(*parse_recover, 1);
 		printf("Failed to open path '%s'\n", path);
 		exit(1);
 	}
 
-	fseek(file, 0, SEEK_END);
-	long length = ftell(file);
-	fseek(file, 0, SEEK_SET);
+	// Map regular files so the AST's string views point straight into the page cache. The lexer may look one
+	// byte past the end, so files filling their last page exactly are read instead to keep a zero byte there
+	char *contents = NULL;
+	size_t length = 0;
+	bool mapped = false;
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) == 0 && S_ISREG(file_stat.st_mode) && file_stat.st_size % sysconf(_SC_PAGESIZE) != 0) {
+		length = file_stat.st_size;
+		contents = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		if (contents == MAP_FAILED) {
+			contents = NULL;
+		} else {
+			mapped = true;
+			madvise(contents, length, MADV_SEQUENTIAL);
+			madvise(contents, length, MADV_WILLNEED);
+		}
+	}
 
-	char *contents = malloc(length);
-	fread(contents, length, 1, file);
+	if (contents == NULL) {
+		contents = read_file_contents(fd, &length);
+		if (contents == NULL) {
+			close(fd);
+			if (parse_recover != NULL) longjmp(*parse_recover, 1);
+			printf("Failed to read path '%s'\n", path);
+			exit(1);
+		}
+	}
 
-	fclose(file);
+	close(fd);
 
+	arrpush(current_compiler->sources, ((Compiler_Source) { .contents = contents, .length = length, .mapped = mapped }));
 	return parse_source(data, contents, length, path);
 }
+
+char *load_path(char *file_path, char *path) {
+	size_t slash_index = 0;
+	for (size_t i = 0; i < strlen(file_path); i++) {
+		if (file_path[i] == '/') {
+			slash_index = i;
+		}
+	}
+
+	char *result = malloc(slash_index + strlen(path) + 2);
+	strncpy(result, file_path, slash_index + 1);
+	result[slash_index + 1] = '\0';
+	strcat(result, path);
+	return result;
+}
+
+void add_module_path(Data *data, char *path) {
+	char *canonical = realpath(path, NULL);
+	if (canonical != NULL) {
+		arrpush(data->module_paths, canonical);
+	}
+}
+
+// Resolves a module name against the search paths in order, to the canonical path of '<name>.lang' or '<name>/module.lang'
+char *import_path(Data *data, char *module) {
+	pthread_mutex_lock(&data->mutex);
+	long int index = shgeti(data->resolved_modules, module);
+	if (index >= 0) {
+		char *result = data->resolved_modules[index].value;
+		pthread_mutex_unlock(&data->mutex);
+		return result;
+	}
+
+	char *result = NULL;
+	char *candidate = NULL;
+	for (long int i = 0; i < arrlen(data->module_paths) && result == NULL; i++) {
+		char *directory = data->module_paths[i];
+		free(candidate);
+		candidate = malloc(strlen(directory) + strlen(module) + sizeof("//module.lang"));
+
+		sprintf(candidate, "%s/%s.lang", directory, module);
+		result = realpath(candidate, NULL);
+		if (result == NULL) {
+			sprintf(candidate, "%s/%s/module.lang", directory, module);
+			result = realpath(candidate, NULL);
+		}
+	}
+
+	// Unresolved modules keep the last candidate, so opening it reports a path the user can recognize
+	if (result == NULL) {
+		result = candidate != NULL ? candidate : module;
+	} else {
+		free(candidate);
+	}
+
+	char *key = malloc(strlen(module) + 1);
+	strcpy(key, module);
+	shput(data->resolved_modules, key, result);
+	pthread_mutex_unlock(&data->mutex);
+
+	return result;
+}
+
+static char *literal_path(Node *node) {
+	if (node->kind != STRING_NODE) return NULL;
+
+	String_View value = node->string.value;
+	for (size_t i = 0; i < value.len; i++) {
+		if (value.ptr[i] == '\\') return NULL;
+	}
+
+	char *result = malloc(value.len + 1);
+	memcpy(result, value.ptr, value.len);
+	result[value.len] = '\0';
+	return result;
+}
+
+static long int find_parse_job(Data *data, char *path) {
+	for (long int i = 0; i < arrlen(data->parse_jobs); i++) {
+		if (strcmp(data->parse_jobs[i].path, path) == 0) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+typedef struct {
+	Data *data;
+	Compiler *compiler;
+} Parse_Worker;
+
+static void *parse_worker(void *argument) {
+	Parse_Worker *worker = argument;
+	Data *data = worker->data;
+	current_compiler = worker->compiler;
+
+	pthread_mutex_lock(&data->mutex);
+	while (true) {
+		long int index = -1;
+		for (long int i = 0; i < arrlen(data->parse_jobs); i++) {
+			if (data->parse_jobs[i].state == PARSE_JOB_QUEUED) {
+				index = i;
+				break;
+			}
+		}
+
+		if (index < 0) {
+			if (data->parse_stopping) break;
+			pthread_cond_wait(&data->work_available, &data->mutex);
+			continue;
+		}
+
+		data->parse_jobs[index].state = PARSE_JOB_PARSING;
+		char *path = data->parse_jobs[index].path;
+		pthread_mutex_unlock(&data->mutex);
+
+		Node *volatile root = NULL;
+		jmp_buf recover;
+		parse_recover = &recover;
+		if (!setjmp(recover)) {
+			root = parse_file(data, path);
+		}
+		parse_recover = NULL;
+
+		if (root != NULL) {
+			parse_prefetch(data, root);
+		}
+
+		pthread_mutex_lock(&data->mutex);
+		data->parse_jobs[index].root = root;
+		data->parse_jobs[index].state = root != NULL ? PARSE_JOB_DONE : PARSE_JOB_FAILED;
+		pthread_cond_broadcast(&data->job_finished);
+	}
+	pthread_mutex_unlock(&data->mutex);
+
+	return NULL;
+}
+
+static void start_parse_workers(Data *data) {
+	long thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+	if (thread_count < 1) thread_count = 1;
+	if (thread_count > 8) thread_count = 8;
+
+	for (long i = 0; i < thread_count; i++) {
+		Parse_Worker *worker = malloc(sizeof(Parse_Worker));
+		worker->data = data;
+		worker->compiler = compiler_create_worker(current_compiler);
+
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, parse_worker, worker) == 0) {
+			arrpush(data->parse_threads, thread);
+		}
+	}
+}
+
+// Queues the files a root loads or imports by literal path, so they are parsed on worker threads before the processor asks for them
+void parse_prefetch(Data *data, Node *root) {
+	for (long int i = 0; i < arrlen(root->root.statements); i++) {
+		Node *statement = root->root.statements[i];
+
+		char *path = NULL;
+		if (statement->kind == LOAD_NODE) {
+			char *relative = literal_path(statement->load.path);
+			if (relative != NULL) {
+				path = load_path(source_path_of(data, statement->location), relative);
+			}
+		} else if (statement->kind == DEFINE_NODE && statement->define.expression->kind == IMPORT_NODE) {
+			char *module = literal_path(statement->define.expression->import.module);
+			if (module != NULL) {
+				path = import_path(data, module);
+			}
+		}
+
+		if (path != NULL) {
+			pthread_mutex_lock(&data->mutex);
+			if (find_parse_job(data, path) < 0) {
+				Parse_Job job = {
+					.path = path,
+					.state = PARSE_JOB_QUEUED
+				};
+				arrpush(data->parse_jobs, job);
+				pthread_cond_signal(&data->work_available);
+
+				// Only the main thread can get here before the workers exist
+				if (arrlen(data->parse_threads) == 0) {
+					start_parse_workers(data);
+				}
+			}
+			pthread_mutex_unlock(&data->mutex);
+		}
+	}
+}
+
+Node *parse_file_prefetched(Data *data, char *path) {
+	Node *root = NULL;
+
+	pthread_mutex_lock(&data->mutex);
+	long int index = find_parse_job(data, path);
+	if (index >= 0) {
+		while (data->parse_jobs[index].state == PARSE_JOB_PARSING) {
+			pthread_cond_wait(&data->job_finished, &data->mutex);
+		}
+
+		if (data->parse_jobs[index].state == PARSE_JOB_DONE) {
+			root = data->parse_jobs[index].root;
+		}
+		data->parse_jobs[index].state = PARSE_JOB_CLAIMED;
+	}
+	pthread_mutex_unlock(&data->mutex);
+
+	if (root == NULL) {
+		root = parse_file(data, path);
+		parse_prefetch(data, root);
+	}
+
+	return root;
+}
+
+void parse_stop(Data *data) {
+	pthread_mutex_lock(&data->mutex);
+	data->parse_stopping = true;
+	pthread_cond_broadcast(&data->work_available);
+	pthread_mutex_unlock(&data->mutex);
+
+	for (long int i = 0; i < arrlen(data->parse_threads); i++) {
+		pthread_join(data->parse_threads[i], NULL);
+	}
+}
@@ -5,4 +5,12 @@
 
 Node *parse_file(Data *data, char *path);
 Node *parse_source(Data *data, char *source, size_t length, char *path);
-Node *parse_source_statement(Data *data, char *source, size_t length, size_t path_ref, size_t row, size_t column);
+Node *parse_source_statement(Data *data, char *source, size_t length, Source_Location location);
+
+char *load_path(char *file_path, char *path);
+void add_module_path(Data *data, char *path);
+char *import_path(Data *data, char *module);
+
+void parse_prefetch(Data *data, Node *root);
+Node *parse_file_prefetched(Data *data, char *path);
+void parse_stop(Data *data);
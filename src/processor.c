@@ -6,6 +6,7 @@
 #include <unistd.h>
 
 #include "ast.h"
+#include "compiler.h"
 #include "evaluator.h"
 #include "parser.h"
 #include "stb/ds.h"
@@ -23,8 +24,17 @@ static Node_Data *process_node_with_scopes(Context *context, Node *node, Scope *
 	if (scopes != NULL) context->scopes = scopes;
 	arrpush(context->scopes, (Scope) { .node = node });
 
+	// Defines are processed on first reference, so keep the referencing function's state out of them
+	bool saved_compile_only = context->compile_only;
+	bool saved_returned = context->returned;
+	context->compile_only = false;
+	context->returned = false;
+
 	Node_Data *data = process_node(context, node);
 
+	context->compile_only = saved_compile_only;
+	context->returned = saved_returned;
+
 	(void) arrpop(context->scopes);
 	if (scopes != NULL) context->scopes = saved_scopes;
 
@@ -224,7 +234,8 @@ static Lookup_Result lookup(Context *context, String_View identifier) {
 }
 
 #define handle_semantic_error(/* Context * */ context, /* Source_Location */ location, /* char * */ fmt, ...) { \
-	printf("%s:%u:%u: " fmt "\n", context->data->source_files[location.path_ref], location.row, location.column __VA_OPT__(,) __VA_ARGS__); \
+	Source_Position position = source_position(context->data, location); \
+	printf("%s:%u:%u: " fmt "\n", position.path, position.row, position.column __VA_OPT__(,) __VA_ARGS__); \
 	exit(1); \
 }
 
@@ -321,6 +332,10 @@ static int print_type_node(Node *type_node, bool pointer, char *buffer) {
 					buffer += sprintf(buffer, "int");
 					break;
 				}
+				case INTERNAL_FLT64: {
+					buffer += sprintf(buffer, "flt64");
+					break;
+				}
 				default:
 					assert(false);
 			}
@@ -471,6 +486,9 @@ static int print_type(Value type, char *buffer) {
 					if (arg.static_) {
 						buffer += sprintf(buffer, "static ");
 					}
+					if (arg.noalias) {
+						buffer += sprintf(buffer, "noalias ");
+					}
 
 					buffer += sprintf(buffer, "%.*s:", (int) arg.identifier.len, arg.identifier.ptr);
 					buffer += print_type(arg.type, buffer);
@@ -527,6 +545,10 @@ static int print_type(Value type, char *buffer) {
 			buffer += sprintf(buffer, "%li", type.value->integer.value);
 			break;
 		}
+		case FLOAT_VALUE: {
+			buffer += sprintf(buffer, "%g", type.value->float_.value);
+			break;
+		}
 		case BYTE_VALUE: {
 			buffer += sprintf(buffer, "%i", type.value->byte.value);
 			break;
@@ -765,6 +787,26 @@ Value process_module_root(Context *context, Node *root) {
 	};
 }
 
+Typed_Value process_root_define(Context *context, Node *root, String_View identifier) {
+	arrpush(context->scopes, ((Scope) { .node = root, .has_static_id = true, .static_id = 1 }));
+	Value_Data *module = get_data(context, root)->root.module;
+	(void) arrpop(context->scopes);
+
+	for (long int i = 0; i < arrlen(module->module.bodies); i++) {
+		Node *define = find_define(module->module.bodies[i], identifier);
+		if (define != NULL) {
+			Scope *scopes = NULL;
+			for (long int j = 0; j < arrlen(module->module.scopes); j++) {
+				arrpush(scopes, module->module.scopes[j]);
+			}
+
+			return process_node_with_scopes(context, define, scopes)->define.typed_value;
+		}
+	}
+
+	return (Typed_Value) {};
+}
+
 static Node_Data *process_function(Context *context, Node *node);
 
 static bool is_literal(Node *node) {
@@ -1146,7 +1188,8 @@ static bool is_valid_overload(Context *context, Define_Scope define) {
 				.identifier = argument.identifier,
 				.type = type,
 				.static_ = argument.static_,
-				.inferred = argument.inferred
+				.inferred = argument.inferred,
+				.noalias = argument.noalias
 			};
 			arrpush(function_argument_values, argument_value);
 		}
@@ -1358,22 +1401,14 @@ static Value process_enforce_pointer(Context *context, Node *node, Value structu
 }
 
 Value get_module(Context *context, char *path) {
-	for (long int i = 0; i < arrlen(context->cached_files); i++) {
-		if (strcmp(context->cached_files[i].path, path) == 0) {
-			return context->cached_files[i].value;
-		}
-	}
+	long int index = shgeti(context->cached_files, path);
+	if (index < 0) return (Value) {};
 
-	return (Value) {};
+	return context->cached_files[index].value;
 }
 
 void add_module(Context *context, char *path, Value value) {
-	Cached_File file = {
-		.path = path,
-		.value = value
-	};
-
-	arrpush(context->cached_files, file);
+	shput(context->cached_files, path, value);
 }
 
 Process_Call_Generic_Result resolve_op(Context *context, Node *node, String_View operator_name, Call_Argument *call_arguments) {
@@ -1534,6 +1569,14 @@ static char *get_operator_name(Binary_Op_Node_Kind kind) {
 			return "/";
 		case OP_MODULUS:
 			return "%";
+		case OP_BITWISE_AND:
+			return "&";
+		case OP_BITWISE_XOR:
+			return "^";
+		case OP_SHIFT_LEFT:
+			return "<<";
+		case OP_SHIFT_RIGHT:
+			return ">>";
 		case OP_EQUALS:
 			return "==";
 		case OP_NOT_EQUALS:
@@ -1576,9 +1619,11 @@ static Node_Data *process_binary_op(Context *context, Node *node) {
 
 	Node_Data *data = context->temporary_context.data;
 
+	bool bitwise = binary_operator.operator == OP_BITWISE_AND || binary_operator.operator == OP_BITWISE_XOR || binary_operator.operator == OP_SHIFT_LEFT || binary_operator.operator == OP_SHIFT_RIGHT;
+
 	Value type = left_type;
 	if (type.value->tag == INTEGER_TYPE_VALUE) {}
-	else if (type.value->tag == FLOAT_TYPE_VALUE) {}
+	else if (type.value->tag == FLOAT_TYPE_VALUE && !bitwise) {}
 	else if (type.value->tag == TYPE_TYPE_VALUE) {}
 	else if (can_compare(type.value) && (binary_operator.operator == OP_EQUALS || binary_operator.operator == OP_NOT_EQUALS)) {}
 	else if (type.value->tag == BOOLEAN_TYPE_VALUE && (binary_operator.operator == OP_AND || binary_operator.operator == OP_OR)) {}
@@ -1608,6 +1653,10 @@ static Node_Data *process_binary_op(Context *context, Node *node) {
 		case OP_MULTIPLY:
 		case OP_DIVIDE:
 		case OP_MODULUS:
+		case OP_BITWISE_AND:
+		case OP_BITWISE_XOR:
+		case OP_SHIFT_LEFT:
+		case OP_SHIFT_RIGHT:
 			result_type = left_type;
 			break;
 		case OP_AND:
@@ -1718,13 +1767,40 @@ static Node_Data *process_break(Context *context, Node *node) {
 	return data;
 }
 
+static bool is_char_type(Value_Data *type) {
+	return type->tag == BYTE_TYPE_VALUE || (type->tag == INTEGER_TYPE_VALUE && type->integer_type.size == 8);
+}
+
+static size_t integer_alias_size(Value_Data *type) {
+	if (type->tag == INTEGER_TYPE_VALUE) return type->integer_type.size;
+	if (type->tag == ENUM_TYPE_VALUE) return 64;
+	return 0;
+}
+
+// Memory may only be accessed through its own type, as in C. Integers and enums of one size differ only in sign,
+// bytes may alias anything and arrays access their elements, so only casts that stay within these rules are allowed.
+// Codegen relies on this for its TBAA tags, and type punning goes through untagged union members instead
+static bool pointees_may_alias(Value_Data *from, Value_Data *to) {
+	if (from == NULL || to == NULL) return true;
+	if (value_equal(from, to)) return true;
+	if (is_char_type(from) || is_char_type(to)) return true;
+
+	if (from->tag == ARRAY_TYPE_VALUE) return pointees_may_alias(from->array_type.inner.value, to);
+	if (to->tag == ARRAY_TYPE_VALUE) return pointees_may_alias(from, to->array_type.inner.value);
+
+	size_t from_size = integer_alias_size(from);
+	if (from_size != 0 && from_size == integer_alias_size(to)) return true;
+
+	return from->tag == POINTER_TYPE_VALUE && to->tag == POINTER_TYPE_VALUE;
+}
+
 static bool is_simple_cast(Value from_type, Value to_type) {
 	if (from_type.value->tag != to_type.value->tag) return false;
 	if (value_equal(from_type.value, to_type.value)) return true;
 
 	switch (from_type.value->tag) {
 		case POINTER_TYPE_VALUE:
-			return true;
+			return pointees_may_alias(from_type.value->pointer_type.inner.value, to_type.value->pointer_type.inner.value);
 		case RESULT_TYPE_VALUE:
 			if (is_simple_cast(from_type.value->result_type.value, to_type.value->result_type.value) && is_simple_cast(from_type.value->result_type.error, to_type.value->result_type.error)) return true;
 			return false;
@@ -2080,24 +2156,59 @@ static Node_Data *process_function(Context *context, Node *node) {
 
 	data->type = function_type_value;
 
+	if (context->compile_only) {
+		data->function.compile_only = true;
+	}
+
 	if (function.body != NULL) {
-		Scope scope = {
+		Pending_Function pending_function = {
 			.node = node,
-			.node_type = function_type_value
+			.scopes = NULL
 		};
-		arrpush(context->scopes, scope);
+		for (long int i = 0; i < arrlen(context->scopes); i++) {
+			arrpush(pending_function.scopes, context->scopes[i]);
+		}
+		arrpush(context->pending_functions, pending_function);
+	}
 
-		Temporary_Context temporary_context = { .wanted_type = function_type_value.value->function_type.return_type };
-		Value returned_type = process_node_context(context, temporary_context, function.body)->type;
+	context->compile_only = compile_only_parent;
+	context->returned = returned_parent;
 
-		if (function_type_value.value->function_type.return_type.value != NULL) {
-			Value wanted_return_type = function_type_value.value->function_type.return_type;
-			if (!type_assignable(wanted_return_type.value, returned_type.value) && !context->returned) {
-				handle_expected_type_error(context, node, wanted_return_type, returned_type);
-			}
+	return data;
+}
+
+static void process_function_body(Context *context, Node *node) {
+	Function_Node function = node->function;
+
+	Node_Data *data = get_data(context, node);
+	Value function_type_value = data->type;
+
+	context->compile_only = data->function.compile_only;
+	context->returned = false;
+
+	size_t saved_slot_count = context->slot_count;
+	bool saved_context_written = context->context_written;
+	Node *saved_tail_return = context->tail_return;
+	context->slot_count = 0;
+	context->context_written = false;
+	context->tail_return = NULL;
+
+	Scope scope = {
+		.node = node,
+		.node_type = function_type_value
+	};
+	arrpush(context->scopes, scope);
+
+	Temporary_Context temporary_context = { .wanted_type = function_type_value.value->function_type.return_type };
+	Value returned_type = process_node_context(context, temporary_context, function.body)->type;
+
+	if (function_type_value.value->function_type.return_type.value != NULL) {
+		Value wanted_return_type = function_type_value.value->function_type.return_type;
+		if (!type_assignable(wanted_return_type.value, returned_type.value) && !context->returned) {
+			handle_expected_type_error(context, node, wanted_return_type, returned_type);
 		}
-		(void) arrpop(context->scopes);
 	}
+	(void) arrpop(context->scopes);
 
 	if (context->compile_only) {
 		data->function.compile_only = true;
@@ -2106,10 +2217,32 @@ static Node_Data *process_function(Context *context, Node *node) {
 		data->function.returned = true;
 	}
 
-	context->compile_only = compile_only_parent;
-	context->returned = returned_parent;
+	// A written context is a copy in the caller's frame, which a tail call can't hand on
+	if (context->context_written && context->tail_return != NULL) {
+		handle_semantic_error(context, context->tail_return->location, "Cannot tail return from a function that writes to the context");
+	}
 
-	return data;
+	data->function.slot_count = context->slot_count;
+	data->function.writes_context = context->context_written;
+	context->slot_count = saved_slot_count;
+	context->context_written = saved_context_written;
+	context->tail_return = saved_tail_return;
+}
+
+void process_pending_functions(Context *context) {
+	Scope *saved_scopes = context->scopes;
+	bool saved_compile_only = context->compile_only;
+	bool saved_returned = context->returned;
+
+	while (arrlen(context->pending_functions) > 0) {
+		Pending_Function pending_function = arrpop(context->pending_functions);
+		context->scopes = pending_function.scopes;
+		process_function_body(context, pending_function.node);
+	}
+
+	context->scopes = saved_scopes;
+	context->compile_only = saved_compile_only;
+	context->returned = saved_returned;
 }
 
 static Node_Data *process_function_stub(Context *context, Node *node) {
@@ -2150,11 +2283,16 @@ static Node_Data *process_function_type(Context *context, Node *node) {
 				}
 			}
 
+			if (function_type.arguments[i].noalias && (type.value == NULL || (type.value->tag != POINTER_TYPE_VALUE && type.value->tag != ARRAY_VIEW_TYPE_VALUE))) {
+				handle_semantic_error(context, node->location, "Argument '%.*s' can only be noalias if it is a pointer or array view", (int) function_type.arguments[i].identifier.len, function_type.arguments[i].identifier.ptr);
+			}
+
 			argument = (Function_Argument_Value) {
 				.identifier = function_type.arguments[i].identifier,
 				.type = type,
 				.default_value = default_value,
-				.static_ = function_type.arguments[i].static_
+				.static_ = function_type.arguments[i].static_,
+				.noalias = function_type.arguments[i].noalias
 			};
 
 			if (function_type.arguments[i].static_) {
@@ -2480,6 +2618,7 @@ static Node_Data *process_if(Context *context, Node *node) {
 				data->type = if_type;
 			}
 		} else {
+			data->if_.then_returned = context->returned;
 			context->returned = saved_returned;
 			if (if_type.value != NULL) {
 				handle_semantic_error(context, node->location, "Expected else");
@@ -2507,25 +2646,18 @@ static Node_Data *process_import(Context *context, Node *node) {
 		source[i] = string.value->string.value[i];
 	}
 
-	Value value = get_module(context, source);
+	char *path = import_path(context->data, source);
+	Value value = get_module(context, path);
 
 	if (value.value == NULL) {
-		char *cwd = getcwd(NULL, PATH_MAX);
-		char *new_source = malloc(strlen(cwd) + 32);
-		sprintf(new_source, "%s/modules/%s.lang", cwd, source);
-
-		if (access(new_source, F_OK) != 0) {
-			sprintf(new_source, "%s/modules/%s/module.lang", cwd, source);
-		}
-
-		Node *file_node = parse_file(context->data, new_source);
+		Node *file_node = parse_file_prefetched(context->data, path);
 
 		Scope *saved_scopes = context->scopes;
 		context->scopes = NULL;
 		value = process_module_root(context, file_node);
 		context->scopes = saved_scopes;
 
-		add_module(context, source, value);
+		add_module(context, path, value);
 	}
 
 	data->type = create_value(MODULE_TYPE_VALUE);
@@ -2533,6 +2665,228 @@ static Node_Data *process_import(Context *context, Node *node) {
 	return data;
 }
 
+static Value_Data *create_type_info(Value type) {
+	Value_Data *result = value_new(TAGGED_UNION_VALUE);
+
+	Value_Data *enum_value = value_new(ENUM_VALUE);
+	Value_Data *value_data = NULL;
+	switch (type.value->tag) {
+		case INTEGER_TYPE_VALUE: {
+			enum_value->enum_.value = 0;
+
+			value_data = value_new(STRUCT_VALUE);
+			value_data->struct_.values = NULL;
+
+			Value_Data *size_value = create_integer(type.value->integer_type.size).value;
+			arrpush(value_data->struct_.values, size_value);
+
+			Value_Data *signed_value = create_boolean(type.value->integer_type.signed_).value;
+			arrpush(value_data->struct_.values, signed_value);
+			break;
+		}
+		case STRUCT_TYPE_VALUE: {
+			enum_value->enum_.value = 1;
+
+			value_data = value_new(STRUCT_VALUE);
+			value_data->struct_.values = NULL;
+
+			Value_Data *items_value = value_new(ARRAY_VIEW_VALUE);
+			items_value->array_view.values = NULL;
+			items_value->array_view.length = create_integer(arrlen(type.value->struct_type.members)).value;
+			for (long int i = 0; i < arrlen(type.value->struct_type.members); i++) {
+				Value_Data *struct_item_value = value_new(STRUCT_VALUE);
+				struct_item_value->struct_.values = NULL;
+
+				String_View name_string;
+				if (type.value->struct_type.node != NULL) {
+					name_string = type.value->struct_type.node->struct_type.members[i].name;
+				} else {
+					char *buffer = malloc(8);
+					memset(buffer, 0, 8);
+					buffer[0] = '_';
+					sprintf(buffer + 1, "%i", (int) i);
+					name_string = cstr_to_sv(buffer);
+				}
+
+				size_t name_string_length = name_string.len;
+
+				Value_Data *name_value = value_new(ARRAY_VIEW_VALUE);
+				name_value->array_view.values = NULL;
+				name_value->array_view.length = create_integer(name_string_length).value;
+				for (size_t i = 0; i < name_string_length; i++) {
+					arrpush(name_value->array_view.values, create_integer(name_string.ptr[i]).value);
+				}
+				arrpush(struct_item_value->struct_.values, name_value);
+
+				Value_Data *type_value = type.value->struct_type.members[i].value;
+				arrpush(struct_item_value->struct_.values, type_value);
+
+				arrpush(items_value->array_view.values, struct_item_value);
+			}
+			arrpush(value_data->struct_.values, items_value);
+			break;
+		}
+		case UNION_TYPE_VALUE: {
+			enum_value->enum_.value = 2;
+
+			value_data = value_new(STRUCT_VALUE);
+			value_data->struct_.values = NULL;
+
+			Value_Data *items_value = value_new(ARRAY_VIEW_VALUE);
+			items_value->array_view.length = create_integer(arrlen(type.value->union_type.items)).value;
+			for (long int i = 0; i < arrlen(type.value->union_type.items); i++) {
+				Value_Data *struct_item_value = value_new(STRUCT_VALUE);
+
+				String_View name_string = type.value->union_type.items[i].identifier;
+				size_t name_string_length = name_string.len;
+
+				Value_Data *name_value = value_new(ARRAY_VIEW_VALUE);
+				name_value->array_view.length = create_integer(name_string_length).value;
+				for (size_t i = 0; i < name_string_length; i++) {
+					arrpush(name_value->array_view.values, create_integer(name_string.ptr[i]).value);
+				}
+				arrpush(struct_item_value->struct_.values, name_value);
+
+				Value_Data *type_value = type.value->union_type.items[i].type.value;
+				arrpush(struct_item_value->struct_.values, type_value);
+
+				arrpush(items_value->array_view.values, struct_item_value);
+			}
+			arrpush(value_data->struct_.values, items_value);
+			break;
+		}
+		case TAGGED_UNION_TYPE_VALUE: {
+			enum_value->enum_.value = 3;
+
+			value_data = value_new(STRUCT_VALUE);
+			value_data->struct_.values = NULL;
+
+			Value_Data *items_value = value_new(ARRAY_VIEW_VALUE);
+			items_value->array_view.length = create_integer(arrlen(type.value->tagged_union_type.items)).value;
+			for (long int i = 0; i < arrlen(type.value->tagged_union_type.items); i++) {
+				Value_Data *struct_item_value = value_new(STRUCT_VALUE);
+
+				String_View name_string = type.value->tagged_union_type.items[i].identifier;
+				size_t name_string_length = name_string.len;
+
+				Value_Data *name_value = value_new(ARRAY_VIEW_VALUE);
+				name_value->array_view.length = create_integer(name_string_length).value;
+				for (size_t i = 0; i < name_string_length; i++) {
+					arrpush(name_value->array_view.values, create_integer(name_string.ptr[i]).value);
+				}
+				arrpush(struct_item_value->struct_.values, name_value);
+
+				Value_Data *type_value = type.value->tagged_union_type.items[i].type.value;
+				arrpush(struct_item_value->struct_.values, type_value);
+
+				arrpush(items_value->array_view.values, struct_item_value);
+			}
+			arrpush(value_data->struct_.values, items_value);
+			break;
+		}
+		case ENUM_TYPE_VALUE: {
+			enum_value->enum_.value = 4;
+
+			value_data = value_new(STRUCT_VALUE);
+			value_data->struct_.values = NULL;
+
+			Value_Data *items_value = value_new(ARRAY_VIEW_VALUE);
+			items_value->array_view.length = create_integer(arrlen(type.value->enum_type.items)).value;
+			for (long int i = 0; i < arrlen(type.value->enum_type.items); i++) {
+				String_View name_string = type.value->enum_type.items[i];
+				size_t name_string_length = name_string.len;
+
+				Value_Data *name_value = value_new(ARRAY_VIEW_VALUE);
+				name_value->array_view.length = create_integer(name_string_length).value;
+				for (size_t i = 0; i < name_string_length; i++) {
+					arrpush(name_value->array_view.values, create_integer(name_string.ptr[i]).value);
+				}
+				arrpush(items_value->array_view.values, name_value);
+			}
+			arrpush(value_data->struct_.values, items_value);
+			break;
+		}
+		case OPTIONAL_TYPE_VALUE: {
+			enum_value->enum_.value = 5;
+
+			value_data = value_new(STRUCT_VALUE);
+			value_data->struct_.values = NULL;
+
+			Value_Data *type_value = type.value->optional_type.inner.value;
+			arrpush(value_data->struct_.values, type_value);
+			break;
+		}
+		case ARRAY_TYPE_VALUE: {
+			enum_value->enum_.value = 6;
+
+			value_data = value_new(STRUCT_VALUE);
+			value_data->struct_.values = NULL;
+
+			Value_Data *size_value = type.value->array_type.size.value;
+			arrpush(value_data->struct_.values, size_value);
+			Value_Data *type_value = type.value->array_type.inner.value;
+			arrpush(value_data->struct_.values, type_value);
+			break;
+		}
+		case ARRAY_VIEW_TYPE_VALUE: {
+			enum_value->enum_.value = 7;
+
+			value_data = value_new(STRUCT_VALUE);
+			value_data->struct_.values = NULL;
+
+			Value_Data *type_value = type.value->array_type.inner.value;
+			arrpush(value_data->struct_.values, type_value);
+			break;
+		}
+		case TUPLE_TYPE_VALUE: {
+			enum_value->enum_.value = 8;
+
+			value_data = value_new(STRUCT_VALUE);
+			value_data->struct_.values = NULL;
+
+			Value_Data *items_value = value_new(ARRAY_VIEW_VALUE);
+			items_value->array_view.values = NULL;
+			items_value->array_view.length = create_integer(arrlen(type.value->tuple_type.members)).value;
+			for (long int i = 0; i < arrlen(type.value->tuple_type.members); i++) {
+				Value_Data *type_value = type.value->tuple_type.members[i].value;
+				arrpush(items_value->array_view.values, type_value);
+			}
+			arrpush(value_data->struct_.values, items_value);
+			break;
+		}
+		case BYTE_TYPE_VALUE: {
+			enum_value->enum_.value = 9;
+
+			value_data = value_new(STRUCT_VALUE);
+			break;
+		}
+		case POINTER_TYPE_VALUE: {
+			enum_value->enum_.value = 10;
+
+			value_data = value_new(STRUCT_VALUE);
+			break;
+		}
+		case BOOLEAN_TYPE_VALUE: {
+			enum_value->enum_.value = 11;
+
+			value_data = value_new(STRUCT_VALUE);
+			break;
+		}
+		case STRING_TYPE_VALUE: {
+			enum_value->enum_.value = 12;
+
+			value_data = value_new(STRUCT_VALUE);
+			break;
+		}
+		default:
+			assert(false);
+	}
+
+	result->tagged_union.tag = enum_value;
+	result->tagged_union.data = value_data;
+	return result;
+}
+
 static Node_Data *process_internal(Context *context, Node *node) {
 	Internal_Node internal = node->internal;
 
@@ -2738,7 +3092,7 @@ static Node_Data *process_internal(Context *context, Node *node) {
 				}
 			}
 
-			data->internal.node = parse_source_statement(context->data, source_string, index, node->location.path_ref, node->location.row, node->location.column);
+			data->internal.node = parse_source_statement(context->data, source_string, index, node->location);
 
 			if (internal.assign_value != NULL) {
 				set_assign_value(data->internal.node, internal.assign_value, internal.assign_kind);
@@ -2786,235 +3140,30 @@ static Node_Data *process_internal(Context *context, Node *node) {
 
 			Value type = evaluate(context, internal.inputs[0]);
 
-			*value = create_value(TAGGED_UNION_VALUE);
-
-			Value_Data *enum_value = value_new(ENUM_VALUE);
-			Value_Data *value_data = NULL;
-			switch (type.value->tag) {
-				case INTEGER_TYPE_VALUE: {
-					enum_value->enum_.value = 0;
-
-					value_data = value_new(STRUCT_VALUE);
-					value_data->struct_.values = NULL;
-
-					Value_Data *size_value = create_integer(type.value->integer_type.size).value;
-					arrpush(value_data->struct_.values, size_value);
-
-					Value_Data *signed_value = create_boolean(type.value->integer_type.signed_).value;
-					arrpush(value_data->struct_.values, signed_value);
-					break;
-				}
-				case STRUCT_TYPE_VALUE: {
-					enum_value->enum_.value = 1;
-
-					value_data = value_new(STRUCT_VALUE);
-					value_data->struct_.values = NULL;
-
-					Value_Data *items_value = value_new(ARRAY_VIEW_VALUE);
-					items_value->array_view.values = NULL;
-					items_value->array_view.length = create_integer(arrlen(type.value->struct_type.members)).value;
-					for (long int i = 0; i < arrlen(type.value->struct_type.members); i++) {
-						Value_Data *struct_item_value = value_new(STRUCT_VALUE);
-						struct_item_value->struct_.values = NULL;
-
-						String_View name_string;
-						if (type.value->struct_type.node != NULL) {
-							name_string = type.value->struct_type.node->struct_type.members[i].name;
-						} else {
-							char *buffer = malloc(8);
-							memset(buffer, 0, 8);
-							buffer[0] = '_';
-							sprintf(buffer + 1, "%i", (int) i);
-							name_string = cstr_to_sv(buffer);
-						}
-
-						size_t name_string_length = name_string.len;
-
-						Value_Data *name_value = value_new(ARRAY_VIEW_VALUE);
-						name_value->array_view.values = NULL;
-						name_value->array_view.length = create_integer(name_string_length).value;
-						for (size_t i = 0; i < name_string_length; i++) {
-							arrpush(name_value->array_view.values, create_integer(name_string.ptr[i]).value);
-						}
-						arrpush(struct_item_value->struct_.values, name_value);
-
-						Value_Data *type_value = type.value->struct_type.members[i].value;
-						arrpush(struct_item_value->struct_.values, type_value);
-
-						arrpush(items_value->array_view.values, struct_item_value);
-					}
-					arrpush(value_data->struct_.values, items_value);
-					break;
-				}
-				case UNION_TYPE_VALUE: {
-					enum_value->enum_.value = 2;
-
-					value_data = value_new(STRUCT_VALUE);
-					value_data->struct_.values = NULL;
-
-					Value_Data *items_value = value_new(ARRAY_VIEW_VALUE);
-					items_value->array_view.length = create_integer(arrlen(type.value->union_type.items)).value;
-					for (long int i = 0; i < arrlen(type.value->union_type.items); i++) {
-						Value_Data *struct_item_value = value_new(STRUCT_VALUE);
-
-						String_View name_string = type.value->union_type.items[i].identifier;
-						size_t name_string_length = name_string.len;
-
-						Value_Data *name_value = value_new(ARRAY_VIEW_VALUE);
-						name_value->array_view.length = create_integer(name_string_length).value;
-						for (size_t i = 0; i < name_string_length; i++) {
-							arrpush(name_value->array_view.values, create_integer(name_string.ptr[i]).value);
-						}
-						arrpush(struct_item_value->struct_.values, name_value);
-
-						Value_Data *type_value = type.value->union_type.items[i].type.value;
-						arrpush(struct_item_value->struct_.values, type_value);
-
-						arrpush(items_value->array_view.values, struct_item_value);
-					}
-					arrpush(value_data->struct_.values, items_value);
-					break;
-				}
-				case TAGGED_UNION_TYPE_VALUE: {
-					enum_value->enum_.value = 3;
-
-					value_data = value_new(STRUCT_VALUE);
-					value_data->struct_.values = NULL;
-
-					Value_Data *items_value = value_new(ARRAY_VIEW_VALUE);
-					items_value->array_view.length = create_integer(arrlen(type.value->tagged_union_type.items)).value;
-					for (long int i = 0; i < arrlen(type.value->tagged_union_type.items); i++) {
-						Value_Data *struct_item_value = value_new(STRUCT_VALUE);
-
-						String_View name_string = type.value->tagged_union_type.items[i].identifier;
-						size_t name_string_length = name_string.len;
-
-						Value_Data *name_value = value_new(ARRAY_VIEW_VALUE);
-						name_value->array_view.length = create_integer(name_string_length).value;
-						for (size_t i = 0; i < name_string_length; i++) {
-							arrpush(name_value->array_view.values, create_integer(name_string.ptr[i]).value);
-						}
-						arrpush(struct_item_value->struct_.values, name_value);
-
-						Value_Data *type_value = type.value->tagged_union_type.items[i].type.value;
-						arrpush(struct_item_value->struct_.values, type_value);
-
-						arrpush(items_value->array_view.values, struct_item_value);
-					}
-					arrpush(value_data->struct_.values, items_value);
-					break;
-				}
-				case ENUM_TYPE_VALUE: {
-					enum_value->enum_.value = 4;
-
-					value_data = value_new(STRUCT_VALUE);
-					value_data->struct_.values = NULL;
-
-					Value_Data *items_value = value_new(ARRAY_VIEW_VALUE);
-					items_value->array_view.length = create_integer(arrlen(type.value->enum_type.items)).value;
-					for (long int i = 0; i < arrlen(type.value->enum_type.items); i++) {
-						String_View name_string = type.value->enum_type.items[i];
-						size_t name_string_length = name_string.len;
-
-						Value_Data *name_value = value_new(ARRAY_VIEW_VALUE);
-						name_value->array_view.length = create_integer(name_string_length).value;
-						for (size_t i = 0; i < name_string_length; i++) {
-							arrpush(name_value->array_view.values, create_integer(name_string.ptr[i]).value);
-						}
-						arrpush(items_value->array_view.values, name_value);
-					}
-					arrpush(value_data->struct_.values, items_value);
-					break;
-				}
-				case OPTIONAL_TYPE_VALUE: {
-					enum_value->enum_.value = 5;
-
-					value_data = value_new(STRUCT_VALUE);
-					value_data->struct_.values = NULL;
-
-					Value_Data *type_value = type.value->optional_type.inner.value;
-					arrpush(value_data->struct_.values, type_value);
-					break;
-				}
-				case ARRAY_TYPE_VALUE: {
-					enum_value->enum_.value = 6;
-
-					value_data = value_new(STRUCT_VALUE);
-					value_data->struct_.values = NULL;
-
-					Value_Data *size_value = type.value->array_type.size.value;
-					arrpush(value_data->struct_.values, size_value);
-					Value_Data *type_value = type.value->array_type.inner.value;
-					arrpush(value_data->struct_.values, type_value);
-					break;
-				}
-				case ARRAY_VIEW_TYPE_VALUE: {
-					enum_value->enum_.value = 7;
-
-					value_data = value_new(STRUCT_VALUE);
-					value_data->struct_.values = NULL;
-
-					Value_Data *type_value = type.value->array_type.inner.value;
-					arrpush(value_data->struct_.values, type_value);
-					break;
-				}
-				case TUPLE_TYPE_VALUE: {
-					enum_value->enum_.value = 8;
-
-					value_data = value_new(STRUCT_VALUE);
-					value_data->struct_.values = NULL;
-
-					Value_Data *items_value = value_new(ARRAY_VIEW_VALUE);
-					items_value->array_view.values = NULL;
-					items_value->array_view.length = create_integer(arrlen(type.value->tuple_type.members)).value;
-					for (long int i = 0; i < arrlen(type.value->tuple_type.members); i++) {
-						Value_Data *type_value = type.value->tuple_type.members[i].value;
-						arrpush(items_value->array_view.values, type_value);
-					}
-					arrpush(value_data->struct_.values, items_value);
-					break;
-				}
-				case BYTE_TYPE_VALUE: {
-					enum_value->enum_.value = 9;
-
-					value_data = value_new(STRUCT_VALUE);
-					break;
-				}
-				case POINTER_TYPE_VALUE: {
-					enum_value->enum_.value = 10;
-
-					value_data = value_new(STRUCT_VALUE);
-					break;
-				}
-				case BOOLEAN_TYPE_VALUE: {
-					enum_value->enum_.value = 11;
-
-					value_data = value_new(STRUCT_VALUE);
-					break;
-				}
-				case STRING_TYPE_VALUE: {
-					enum_value->enum_.value = 12;
-
-					value_data = value_new(STRUCT_VALUE);
+			// Type_Info values are never mutated, so every query for the same type shares one
+			size_t hash = value_hash(type.value);
+			Type_Info_Entry *entries = hmget(context->type_infos, hash);
+			Value_Data *type_info = NULL;
+			for (long int i = 0; i < arrlen(entries); i++) {
+				if (entries[i].type == type.value || value_equal(entries[i].type, type.value)) {
+					type_info = entries[i].type_info;
 					break;
 				}
-				default:
-					assert(false);
 			}
 
-			value->value->tagged_union.tag = enum_value;
-			value->value->tagged_union.data = value_data;
+			if (type_info == NULL) {
+				type_info = create_type_info(type);
+				arrpush(entries, ((Type_Info_Entry) { .type = type.value, .type_info = type_info }));
+				hmput(context->type_infos, hash, entries);
+			}
+			*value = (Value) { .value = type_info };
 
-			arrpush(context->scopes, ((Scope) { .node = node, .has_static_id = true, .static_id = 1 }));
-			Value type_info_type = get_data(context, find_define(context->internal_root, cstr_to_sv("Type_Info")))->define.typed_value.value;
-			(void) arrpop(context->scopes);
+			Value type_info_type = process_root_define(context, context->internal_root, cstr_to_sv("Type_Info")).value;
 			data->type = type_info_type;
 			return data;
 		}
 		case INTERNAL_OS: {
-			arrpush(context->scopes, ((Scope) { .node = node, .has_static_id = true, .static_id = 1 }));
-			Value operating_system_type = get_data(context, find_define(context->internal_root, cstr_to_sv("Operating_System")))->define.typed_value.value;
-			(void) arrpop(context->scopes);
+			Value operating_system_type = process_root_define(context, context->internal_root, cstr_to_sv("Operating_System")).value;
 
 			#if defined(__linux__)
 				size_t os_value = 0;
@@ -3076,9 +3225,11 @@ static Node_Data *process_internal(Context *context, Node *node) {
 					handle_expected_type_error(context, node, context_type, type);
 				}
 
+				context->context_written = true;
 				return data;
 			} else {
 				if (context->temporary_context.want_pointer) {
+					context->context_written = true;
 					data->internal.want_pointer = true;
 					data->type = create_pointer_type(context_type);
 				} else {
@@ -3160,21 +3311,7 @@ static Node_Data *process_load(Context *context, Node *node) {
 		source[i] = string.value->string.value[i];
 	}
 
-	size_t slash_index = 0;
-	char *node_path = context->data->source_files[node->location.path_ref];
-	for (size_t i = 0; i < strlen(node_path); i++) {
-		if (node_path[i] == '/') {
-			slash_index = i;
-		}
-	}
-
-	char *old_source = source;
-	source = malloc(slash_index + strlen(source) + 2);
-	strncpy(source, node_path, slash_index + 1);
-	source[slash_index + 1] = '\0';
-	strcat(source, old_source);
-
-	Node *file_node = parse_file(context->data, source);
+	Node *file_node = parse_file_prefetched(context->data, load_path(source_path_of(context->data, node->location), source));
 
 	Node_Data *data = context->temporary_context.data;
 	data->load.file = file_node;
@@ -3219,8 +3356,6 @@ static Node_Data *process_null(Context *context, Node *node) {
 	return data;
 }
 
-Node *sint_node;
-
 static Node_Data *process_number(Context *context, Node *node) {
 	Number_Node number = node->number;
 
@@ -3236,11 +3371,12 @@ static Node_Data *process_number(Context *context, Node *node) {
 			wanted_type = create_float_type(context->codegen.default_integer_size);
 		} else {
 			wanted_type = create_integer_type(true, context->codegen.default_integer_size);
-			if (sint_node == NULL) {
-				sint_node = ast_new(INTERNAL_NODE, (Source_Location) {});
-				sint_node->internal.kind = INTERNAL_INT;
+			Compiler *compiler = context->compiler;
+			if (compiler->sint_node == NULL) {
+				compiler->sint_node = node_at(ast_new(INTERNAL_NODE, (Source_Location) {}));
+				compiler->sint_node->internal.kind = INTERNAL_INT;
 			}
-			wanted_type.node = sint_node;
+			wanted_type.node = compiler->sint_node;
 		}
 	}
 
@@ -3352,6 +3488,94 @@ static Node_Data *process_result(Context *context, Node *node) {
 	return data;
 }
 
+// The lowered signature only depends on the runtime arguments and result, so matching those lets the callee take over the caller's frame
+static bool tail_callable(Value_Data *caller, Value_Data *callee) {
+	Function_Type_Value caller_type = caller->function_type;
+	Function_Type_Value callee_type = callee->function_type;
+	if (caller_type.variadic || callee_type.variadic) return false;
+
+	if ((caller_type.return_type.value == NULL) != (callee_type.return_type.value == NULL)) return false;
+	if (caller_type.return_type.value != NULL && !value_equal(caller_type.return_type.value, callee_type.return_type.value)) return false;
+
+	long int i = 0;
+	long int j = 0;
+	while (true) {
+		while (i < arrlen(caller_type.arguments) && caller_type.arguments[i].static_) i++;
+		while (j < arrlen(callee_type.arguments) && callee_type.arguments[j].static_) j++;
+		if (i == arrlen(caller_type.arguments) || j == arrlen(callee_type.arguments)) break;
+
+		if (caller_type.arguments[i].noalias != callee_type.arguments[j].noalias) return false;
+		if (!value_equal(caller_type.arguments[i].type.value, callee_type.arguments[j].type.value)) return false;
+		i++;
+		j++;
+	}
+
+	return i == arrlen(caller_type.arguments) && j == arrlen(callee_type.arguments);
+}
+
+// Parents of field and element accesses are reprocessed for their own address when they aren't pointers already
+static bool is_own_address(Context *context, Node *node) {
+	Node_Data *data = get_data(context, node);
+	switch (node->kind) {
+		case IDENTIFIER_NODE:
+			return data->identifier.want_pointer;
+		case STRUCTURE_ACCESS_NODE:
+			return data->structure_access.want_pointer;
+		case ARRAY_ACCESS_NODE:
+			return data->array_access.want_pointer;
+		default:
+			return false;
+	}
+}
+
+// Whether a place lives in the current frame, as a variable, argument or binding or as a part of one held by value
+static bool is_frame_place(Context *context, Node *node) {
+	switch (node->kind) {
+		case IDENTIFIER_NODE: {
+			Identifier_Data identifier = get_data(context, node)->identifier;
+			return identifier.kind == IDENTIFIER_VARIABLE || identifier.kind == IDENTIFIER_ARGUMENT || identifier.kind == IDENTIFIER_BINDING;
+		}
+		case STRUCTURE_ACCESS_NODE: {
+			Node *parent = node->structure_access.parent;
+			if (get_data(context, parent)->type.value->tag == POINTER_TYPE_VALUE && !is_own_address(context, parent)) return false;
+			return is_frame_place(context, parent);
+		}
+		case ARRAY_ACCESS_NODE: {
+			Node *parent = node->array_access.parent;
+			Value_Data *parent_type = get_data(context, parent)->type.value;
+			if (parent_type->tag == POINTER_TYPE_VALUE && is_own_address(context, parent)) parent_type = parent_type->pointer_type.inner.value;
+			if (parent_type->tag != ARRAY_TYPE_VALUE) return false;
+			return is_frame_place(context, parent);
+		}
+		default:
+			return false;
+	}
+}
+
+// A tail call replaces the caller's frame, so no argument may point into it
+static bool takes_frame_address(Context *context, Node *node) {
+	switch (node->kind) {
+		case REFERENCE_NODE:
+			return is_frame_place(context, node->reference.node);
+		case SLICE_NODE: {
+			Node *parent = node->slice.parent;
+			Value_Data *parent_type = get_data(context, parent)->type.value;
+			if (parent_type->tag == POINTER_TYPE_VALUE && is_own_address(context, parent)) parent_type = parent_type->pointer_type.inner.value;
+			return parent_type->tag == ARRAY_TYPE_VALUE && is_frame_place(context, parent);
+		}
+		case CAST_NODE:
+			return takes_frame_address(context, node->cast.node);
+		case STRUCTURE_NODE: {
+			for (long int i = 0; i < arrlen(node->structure.values); i++) {
+				if (takes_frame_address(context, node->structure.values[i].node)) return true;
+			}
+			return false;
+		}
+		default:
+			return false;
+	}
+}
+
 static Node_Data *process_return(Context *context, Node *node) {
 	Return_Node return_ = node->return_;
 
@@ -3366,7 +3590,8 @@ static Node_Data *process_return(Context *context, Node *node) {
 		}
 	}
 
-	Value return_type = get_data(context, current_function->function.function_type)->function_type.value.value->function_type.return_type;
+	Value function_type = get_data(context, current_function->function.function_type)->function_type.value;
+	Value return_type = function_type.value->function_type.return_type;
 
 	Node_Data *data = context->temporary_context.data;
 	if (return_.value != NULL) {
@@ -3379,6 +3604,31 @@ static Node_Data *process_return(Context *context, Node *node) {
 		}
 	}
 
+	if (return_.tail) {
+		if (return_.value == NULL || return_.value->kind != CALL_NODE) {
+			handle_semantic_error(context, node->location, "Tail return requires a function call");
+		}
+
+		Call_Data call_data = get_data(context, return_.value)->call;
+		Value_Data *function_value = call_data.function_value.value;
+		if (function_value != NULL && function_value->tag == FUNCTION_VALUE && function_value->function.node->function.extern_.ptr != NULL) {
+			handle_semantic_error(context, node->location, "Cannot tail call an extern function");
+		}
+
+		if (!tail_callable(function_type.value, call_data.function_type.value)) {
+			handle_2type_error(node, "Cannot tail call %s from a function of type %s", call_data.function_type, function_type);
+		}
+
+		Call_Argument *arguments = return_.value->call.arguments;
+		for (long int i = 0; i < arrlen(arguments); i++) {
+			if (takes_frame_address(context, arguments[i].node)) {
+				handle_semantic_error(context, arguments[i].node->location, "Cannot pass the address of a local variable or argument to a tail call");
+			}
+		}
+
+		if (context->tail_return == NULL) context->tail_return = node;
+	}
+
 	data->return_.type = return_type;
 	return data;
 }
@@ -3395,6 +3645,8 @@ static Node_Data *process_root(Context *context, Node *node) {
 
 	for (long int i = 0; i < arrlen(root.statements); i++) {
 		Node *statement = root.statements[i];
+		if (statement->kind == DEFINE_NODE) continue;
+
 		process_node(context, statement);
 	}
 
@@ -3654,6 +3906,7 @@ static Node_Data *process_structure_access(Context *context, Node *node) {
 				for (long int i = 0; i < arrlen(structure_type.value->struct_type.members); i++) {
 					if (sv_eq(structure_type.value->struct_type.node->struct_type.members[i].name, structure_access.name)) {
 						item_type = structure_type.value->struct_type.members[i];
+						data->structure_access.index = i;
 						break;
 					}
 				}
@@ -3665,6 +3918,7 @@ static Node_Data *process_structure_access(Context *context, Node *node) {
 					sprintf(name, "_%li", i);
 					if (sv_eq_cstr(structure_access.name, name)) {
 						item_type = structure_type.value->tuple_type.members[i];
+						data->structure_access.index = i;
 						break;
 					}
 				}
@@ -3674,6 +3928,7 @@ static Node_Data *process_structure_access(Context *context, Node *node) {
 				for (long int i = 0; i < arrlen(structure_type.value->union_type.items); i++) {
 					if (sv_eq(structure_type.value->union_type.items[i].identifier, structure_access.name)) {
 						item_type = structure_type.value->union_type.items[i].type;
+						data->structure_access.index = i;
 						break;
 					}
 				}
@@ -3682,16 +3937,20 @@ static Node_Data *process_structure_access(Context *context, Node *node) {
 			case ARRAY_VIEW_TYPE_VALUE: {
 				if (sv_eq_cstr(structure_access.name, "len")) {
 					item_type = create_integer_type(false, context->codegen.default_integer_size);
+					data->structure_access.index = 0;
 				} else if (sv_eq_cstr(structure_access.name, "data")) {
 					item_type = create_pointer_type(create_array_type(structure_type.value->array_view_type.inner));
+					data->structure_access.index = 1;
 				}
 				break;
 			}
 			case STRING_TYPE_VALUE: {
 				if (sv_eq_cstr(structure_access.name, "len")) {
 					item_type = create_integer_type(false, context->codegen.default_integer_size);
+					data->structure_access.index = 0;
 				} else if (sv_eq_cstr(structure_access.name, "data")) {
 					item_type = create_pointer_type(create_array_type(create_integer_type(false, 8)));
+					data->structure_access.index = 1;
 				}
 				break;
 			}
@@ -4046,6 +4305,18 @@ Node_Data *process_node_context(Context *context, Temporary_Context temporary_co
 
 	(*data)->processed = true;
 
+	switch (node->kind) {
+		case CATCH_NODE:
+		case FOR_NODE:
+		case IF_NODE:
+		case VARIABLE_NODE:
+		case WHILE_NODE:
+			(*data)->slot = context->slot_count++;
+			break;
+		default:
+			break;
+	}
+
 	temporary_context.data = *data;
 
 	Temporary_Context saved_temporary_context = context->temporary_context;
@@ -1,5 +1,7 @@
 #include "common.h"
 
 Value process_module_root(Context *context, Node *root);
+Typed_Value process_root_define(Context *context, Node *root, String_View identifier);
 Node_Data *process_node(Context *context, Node *node);
+void process_pending_functions(Context *context);
 Node *find_define(Node *root, String_View identifier);
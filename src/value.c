@@ -1,18 +1,17 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "compiler.h"
 #include "value.h"
 
-Value_Data *values = NULL;
-size_t value_index = 0;
-
 Value_Data *value_new(Value_Tag tag) {
-	if (values == NULL || value_index == 65536) {
-		values = malloc(sizeof(Value_Data) * 65536);
-		value_index = 0;
+	Compiler *compiler = current_compiler;
+	if (compiler->values == NULL || compiler->value_index == 65536) {
+		compiler->values = compiler_allocate(compiler, sizeof(Value_Data) * 65536);
+		compiler->value_index = 0;
 	}
 
-	Value_Data *value = &values[value_index++];
+	Value_Data *value = &compiler->values[compiler->value_index++];
 	value->tag = tag;
 	return value;
 }
@@ -72,6 +71,12 @@ Value create_integer(size_t value) {
 	return integer;
 }
 
+Value create_float(double value) {
+	Value float_ = create_value(FLOAT_VALUE);
+	float_.value->float_.value = value;
+	return float_;
+}
+
 Value create_byte(char value) {
 	Value byte = create_value(BYTE_VALUE);
 	byte.value->byte.value = value;
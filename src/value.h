@@ -13,6 +13,7 @@ typedef enum {
 	BYTE_TYPE_VALUE,
 	ENUM_VALUE,
 	ENUM_TYPE_VALUE,
+	FLOAT_VALUE,
 	FLOAT_TYPE_VALUE,
 	FUNCTION_VALUE,
 	FUNCTION_STUB_VALUE,
@@ -75,6 +76,10 @@ typedef struct {
 	String_View *items; // stb_ds
 } Enum_Type_Value;
 
+typedef struct {
+	double value;
+} Float_Value;
+
 typedef struct {
 	size_t size;
 } Float_Type_Value;
@@ -96,6 +101,7 @@ typedef struct {
 	Value type;
 	bool static_;
 	bool inferred;
+	bool noalias;
 	Value default_value;
 } Function_Argument_Value;
 
@@ -237,6 +243,7 @@ struct Value_Data {
 		Const_Type_Value const_type;
 		Enum_Value enum_;
 		Enum_Type_Value enum_type;
+		Float_Value float_;
 		Float_Type_Value float_type;
 		Function_Value function;
 		Function_Stub_Value function_stub;
@@ -276,6 +283,7 @@ Value create_float_type(size_t size);
 Value create_range_type(Value value);
 
 Value create_integer(size_t value);
+Value create_float(double value);
 Value create_byte(char value);
 Value create_boolean(bool value);
 Value create_enum(size_t value);